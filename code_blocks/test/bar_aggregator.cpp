@@ -0,0 +1,81 @@
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <ztime_bar_aggregator.hpp>
+
+int main() {
+    // ticks every 3 seconds over 40 days
+    std::vector<ztime::timestamp_t> t;
+    std::vector<double> price;
+    std::vector<double> volume;
+    const ztime::timestamp_t start = ztime::get_timestamp(25, 1, 2024);
+    for (ztime::timestamp_t ts = start; ts < (start + 40 * ztime::SEC_PER_DAY); ts += 3) {
+        t.push_back(ts);
+        price.push_back(100.0 + 10.0 * std::sin((double)ts / 10000.0));
+        volume.push_back(1.0);
+    }
+
+    const uint32_t periods[] = {
+        ztime::PERIOD_M1, ztime::PERIOD_M5, ztime::PERIOD_H1,
+        ztime::PERIOD_D1, ztime::PERIOD_W1, ztime::PERIOD_MN1, 7,
+        ztime::SEC_PER_WEEK
+    };
+    const size_t num_periods = sizeof(periods) / sizeof(periods[0]);
+
+    std::vector<ztime::Bar> stream_bars;
+    std::vector<ztime::Bar> batch_bars;
+
+    ztime::BarAggregator stream([&](const ztime::Bar &bar, const uint32_t period) {
+        stream_bars.push_back(bar);
+        if (period == ztime::PERIOD_MN1 || period == ztime::PERIOD_W1) {
+            std::cout << "period " << period << " bar " << ztime::get_str_date_time(bar.timestamp)
+                << " O " << bar.open << " H " << bar.high << " L " << bar.low
+                << " C " << bar.close << " V " << bar.volume << std::endl;
+        }
+    });
+    ztime::BarAggregator batch([&](const ztime::Bar &bar, const uint32_t) {
+        batch_bars.push_back(bar);
+    });
+    for (size_t i = 0; i < num_periods; ++i) {
+        stream.add_timeframe(periods[i]);
+        batch.add_timeframe(periods[i]);
+    }
+    stream_bars.reserve(t.size());
+    batch_bars.reserve(t.size());
+
+    ztime::Timer timer;
+    for (size_t i = 0; i < t.size(); ++i) {
+        stream.push(t[i], price[i], volume[i]);
+    }
+    stream.flush();
+    std::cout << "stream: " << stream_bars.size() << " bars " << timer.elapsed() << " s" << std::endl;
+
+    timer.reset();
+    batch.push(t.data(), price.data(), volume.data(), t.size());
+    batch.flush();
+    std::cout << "batch:  " << batch_bars.size() << " bars " << timer.elapsed() << " s" << std::endl;
+
+    // bars of the batch mode are grouped by timeframes, so compare the sums
+    double stream_volume = 0, batch_volume = 0;
+    for (size_t i = 0; i < stream_bars.size(); ++i) stream_volume += stream_bars[i].volume;
+    for (size_t i = 0; i < batch_bars.size(); ++i) batch_volume += batch_bars[i].volume;
+
+    // a fixed week of seconds is not the calendar week
+    bool is_fixed_week = true;
+    if (ztime::BarAggregator::get_bar_start(ztime::SEC_PER_WEEK, start) !=
+        ztime::get_first_timestamp_period(ztime::SEC_PER_WEEK, start)) is_fixed_week = false;
+    if (ztime::BarAggregator::get_bar_start(ztime::PERIOD_W1, start) !=
+        ztime::get_week_start_first_timestamp(start)) is_fixed_week = false;
+    if (ztime::BarAggregator::get_bar_start(ztime::SEC_PER_WEEK, start) ==
+        ztime::BarAggregator::get_bar_start(ztime::PERIOD_W1, start)) is_fixed_week = false;
+
+    if (is_fixed_week &&
+        stream_bars.size() == batch_bars.size() &&
+        stream_volume == batch_volume &&
+        stream_volume == (double)(t.size() * num_periods)) {
+        std::cout << "ok" << std::endl;
+    } else {
+        std::cout << "error" << std::endl;
+    }
+    return 0;
+}
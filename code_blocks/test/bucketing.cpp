@@ -0,0 +1,76 @@
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <ztime_bucketing.hpp>
+
+int main() {
+    // one timestamp every 10 minutes over 3 years
+    std::vector<ztime::timestamp_t> data;
+    const ztime::timestamp_t start = ztime::get_timestamp(15, 11, 2022, 12, 0, 0);
+    for (ztime::timestamp_t t = start; t < (start + 3 * 365 * ztime::SEC_PER_DAY); t += 600) {
+        data.push_back(t);
+    }
+
+    const ztime::BucketUnit units[] = {
+        ztime::BUCKET_WEEK, ztime::BUCKET_MONTH,
+        ztime::BUCKET_QUARTER, ztime::BUCKET_YEAR
+    };
+    const char *names[] = {"week", "month", "quarter", "year"};
+
+    bool is_ok = true;
+    std::vector<uint32_t> index(data.size());
+    for (size_t u = 0; u < 4; ++u) {
+        ztime::CalendarBuckets buckets;
+        buckets.build(units[u], data.data(), data.size());
+
+        ztime::Timer timer;
+        buckets.assign(data.data(), data.size(), index.data());
+        const double assign_time = timer.elapsed();
+
+        timer.reset();
+        std::vector<ztime::BucketSegment> segments;
+        buckets.segments(data.data(), data.size(), segments);
+        const double segments_time = timer.elapsed();
+
+        std::cout << names[u] << ": buckets " << buckets.size()
+            << " segments " << segments.size()
+            << " assign " << assign_time << " s"
+            << " segments " << segments_time << " s" << std::endl;
+        std::cout << "  first " << ztime::get_str_date_time(buckets.get_start(0))
+            << " last " << ztime::get_str_date_time(buckets.get_start(buckets.size() - 1)) << std::endl;
+
+        // reference check with the calendar functions
+        for (size_t i = 0; i < data.size(); i += 97) {
+            const ztime::timestamp_t t = buckets.get_start(index[i]);
+            ztime::timestamp_t expected = 0;
+            switch (units[u]) {
+            case ztime::BUCKET_WEEK: expected = ztime::get_week_start_first_timestamp(data[i]); break;
+            case ztime::BUCKET_MONTH: expected = ztime::get_first_timestamp_month(data[i]); break;
+            case ztime::BUCKET_QUARTER: {
+                    const uint32_t month = ztime::get_month(data[i]);
+                    expected = ztime::get_timestamp(1, month - (month - 1) % 3, ztime::get_year(data[i]));
+                    break;
+                }
+            default: expected = ztime::start_of_year(data[i]); break;
+            };
+            if (t != expected) is_ok = false;
+        }
+        size_t total = 0;
+        for (size_t i = 0; i < segments.size(); ++i) {
+            total += segments[i].end - segments[i].begin;
+            if (index[segments[i].begin] != segments[i].bucket) is_ok = false;
+        }
+        if (total != data.size()) is_ok = false;
+
+        // unsorted input
+        std::vector<ztime::timestamp_t> shuffled(data.begin(), data.begin() + 1000);
+        std::reverse(shuffled.begin(), shuffled.end());
+        std::vector<uint32_t> shuffled_index(shuffled.size());
+        buckets.assign(shuffled.data(), shuffled.size(), shuffled_index.data());
+        for (size_t i = 0; i < shuffled.size(); ++i) {
+            if (shuffled_index[i] != index[shuffled.size() - 1 - i]) is_ok = false;
+        }
+    }
+    std::cout << (is_ok ? "ok" : "error") << std::endl;
+    return 0;
+}
@@ -0,0 +1,53 @@
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <ztime_business_calendar.hpp>
+
+int main() {
+    {
+        std::ofstream file("holidays.txt");
+        file << "# holidays 2024" << std::endl;
+        file << "2024-01-01" << std::endl;
+        file << "25.12.2024" << std::endl;
+        file << "26.12.2024" << std::endl;
+    }
+
+    ztime::BusinessCalendar calendar;
+    std::cout << "load_holidays: " << calendar.load_holidays("holidays.txt") << std::endl;
+    std::remove("holidays.txt");
+    calendar.compile(ztime::get_timestamp(1, 12, 2023), ztime::get_timestamp(31, 12, 2025));
+
+    const ztime::timestamp_t t = ztime::get_timestamp(20, 12, 2024, 12, 0, 0); // Friday
+    std::cout << "is_business_day " << ztime::get_str_date_time(t) << ": " << calendar.is_business_day(t) << std::endl;
+    std::cout << "add_business_days(+2): " << ztime::get_str_date_time(calendar.add_business_days(t, 2)) << std::endl;
+    std::cout << "add_business_days(-5): " << ztime::get_str_date_time(calendar.add_business_days(t, -5)) << std::endl;
+    std::cout << "next_business_day(24.12): " << ztime::get_str_date(calendar.next_business_day(ztime::get_timestamp(24, 12, 2024))) << std::endl;
+    std::cout << "prev_business_day(02.01): " << ztime::get_str_date(calendar.prev_business_day(ztime::get_timestamp(2, 1, 2024))) << std::endl;
+
+    const int64_t days_2024 = calendar.business_days_between(
+        ztime::get_timestamp(1, 1, 2024),
+        ztime::get_timestamp(1, 1, 2025));
+    std::cout << "business days 2024: " << days_2024 << std::endl;
+
+    // reference loop
+    int64_t expected = 0;
+    for (uint32_t day = ztime::get_day(ztime::get_timestamp(1, 1, 2024));
+        day < ztime::get_day(ztime::get_timestamp(1, 1, 2025)); ++day) {
+        if (ztime::is_day_off_for_day(day)) continue;
+        const ztime::timestamp_t d = ztime::get_timestamp_day(day);
+        if (d == ztime::get_timestamp(1, 1, 2024) ||
+            d == ztime::get_timestamp(25, 12, 2024) ||
+            d == ztime::get_timestamp(26, 12, 2024)) continue;
+        ++expected;
+    }
+
+    if (days_2024 == expected &&
+        calendar.add_business_days(t, 2) == ztime::get_timestamp(24, 12, 2024, 12, 0, 0) &&
+        calendar.next_business_day(ztime::get_timestamp(24, 12, 2024)) == ztime::get_timestamp(27, 12, 2024) &&
+        calendar.prev_business_day(ztime::get_timestamp(2, 1, 2024)) == ztime::get_timestamp(29, 12, 2023)) {
+        std::cout << "ok" << std::endl;
+    } else {
+        std::cout << "error, expected " << expected << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,105 @@
+#include <iostream>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "ztime.hpp"
+#include "ztime_coroutine.hpp"
+
+ztime::Task<int> slow_answer(const int delay_ms) {
+    co_await ztime::sleep_for(std::chrono::milliseconds(delay_ms));
+    co_return 42;
+}
+
+ztime::Task<void> fail() {
+    co_await ztime::sleep_for(std::chrono::milliseconds(1));
+    throw std::runtime_error("fail");
+}
+
+ztime::Task<int64_t> measure_sleep(const int delay_ms) {
+    const auto start = std::chrono::steady_clock::now();
+    co_await ztime::sleep_for(std::chrono::milliseconds(delay_ms));
+    co_return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+ztime::Task<void> sleeper(std::atomic<int> &counter, const int delay_ms) {
+    co_await ztime::sleep_for(std::chrono::milliseconds(delay_ms));
+    ++counter;
+}
+
+int main() {
+    bool is_ok = true;
+
+    // sleep_for and sleep_until
+    {
+        const int64_t elapsed = ztime::sync_wait(measure_sleep(50));
+        std::cout << "sleep_for 50 ms: " << elapsed << " ms" << std::endl;
+        if (elapsed < 50 || elapsed > 100) is_ok = false;
+
+        const auto start = std::chrono::steady_clock::now();
+        ztime::sync_wait([]() -> ztime::Task<void> {
+            co_await ztime::sleep_until(std::chrono::steady_clock::now() + std::chrono::milliseconds(30));
+            co_await ztime::sleep_until(ztime::get_ftimestamp() + 0.03);
+        }());
+        const int64_t until = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "sleep_until 30 + 30 ms: " << until << " ms" << std::endl;
+        if (until < 55 || until > 120) is_ok = false;
+    }
+
+    // thousands of sleeping coroutines do not need threads
+    {
+        std::atomic<int> counter(0);
+        for (int i = 0; i < 1000; ++i) {
+            ztime::spawn(sleeper(counter, 10 + i % 20));
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        std::cout << "spawned: " << counter << std::endl;
+        if (counter != 1000) is_ok = false;
+    }
+
+    // with_timeout
+    {
+        std::optional<int> fast = ztime::sync_wait([]() -> ztime::Task<std::optional<int>> {
+            co_return co_await ztime::with_timeout(slow_answer(10), std::chrono::milliseconds(200));
+        }());
+        std::optional<int> slow = ztime::sync_wait([]() -> ztime::Task<std::optional<int>> {
+            co_return co_await ztime::with_timeout(slow_answer(200), std::chrono::milliseconds(20));
+        }());
+        bool is_thrown = false;
+        try {
+            ztime::sync_wait([]() -> ztime::Task<bool> {
+                co_return co_await ztime::with_timeout(fail(), std::chrono::milliseconds(100));
+            }());
+        } catch (const std::runtime_error &) {
+            is_thrown = true;
+        }
+        std::cout << "with_timeout: " << (fast ? *fast : -1) << " " << (slow ? *slow : -1) << " " << is_thrown << std::endl;
+        if (!fast || *fast != 42 || slow || !is_thrown) is_ok = false;
+        // the dropped task ends on its own
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    }
+
+    // periodic ticks on an executor
+    {
+        std::shared_ptr<ztime::Executor> executor = std::make_shared<ztime::ThreadPoolExecutor>(2);
+        std::atomic<bool> is_executor_thread(true);
+        const std::thread::id main_id = std::this_thread::get_id();
+        const uint64_t ticks = ztime::sync_wait([&]() -> ztime::Task<uint64_t> {
+            ztime::Ticker ticker(std::chrono::milliseconds(10), executor);
+            uint64_t total = 0;
+            for (int i = 0; i < 5; ++i) {
+                total += co_await ticker.next();
+                if (std::this_thread::get_id() == main_id) is_executor_thread = false;
+            }
+            // missed ticks are reported by the next call
+            std::this_thread::sleep_for(std::chrono::milliseconds(35));
+            total += co_await ticker.next();
+            co_return total;
+        }());
+        std::cout << "ticks: " << ticks << std::endl;
+        if (ticks < 8 || ticks > 10 || !is_executor_thread) is_ok = false;
+    }
+
+    if (is_ok) std::cout << "ok" << std::endl;
+    else std::cout << "error" << std::endl;
+    return 0;
+}
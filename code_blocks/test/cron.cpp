@@ -0,0 +1,80 @@
+#include <iostream>
+#include <ztime.hpp>
+#include <ztime_cron.hpp>
+
+bool check(const std::string &expression, const std::string &from, const std::string &expected, const ztime::TimeZone zone = ztime::GMT) {
+    ztime::CronExpression cron(expression);
+    const ztime::timestamp_t next = cron.next(ztime::to_timestamp(from), zone);
+    const std::string result = next ? ztime::get_str_date_time(next) : std::string("none");
+    const bool is_ok = result == expected;
+    std::cout << (is_ok ? "ok    " : "error ") << expression << " after " << from << ": " << result << std::endl;
+    return is_ok;
+}
+
+int main() {
+    bool is_ok = true;
+
+    // fields, ranges, steps and names
+    is_ok &= check("0 * * * *", "10.03.2024 12:34:56", "10.03.2024 13:00:00");
+    is_ok &= check("* * * * *", "10.03.2024 12:34:56", "10.03.2024 12:35:00");
+    is_ok &= check("*/15 9-17 * * MON-FRI", "08.03.2024 17:50:00", "11.03.2024 09:00:00");
+    is_ok &= check("30 */10 * * * *", "31.12.2023 23:59:40", "01.01.2024 00:00:30");
+    is_ok &= check("0 0 29 2 *", "01.03.2024 00:00:00", "29.02.2028 00:00:00");
+    is_ok &= check("0 12 * JUN,dec 7", "01.01.2024 00:00:00", "02.06.2024 12:00:00");
+    is_ok &= check("@hourly", "10.03.2024 23:00:00", "11.03.2024 00:00:00");
+    is_ok &= check("@monthly", "31.01.2024 00:00:00", "01.02.2024 00:00:00");
+
+    // calendar rules
+    is_ok &= check("0 0 * * 0L", "01.03.2024 00:00:00", "31.03.2024 00:00:00");
+    is_ok &= check("0 0 * * SUNL", "31.03.2024 00:00:00", "28.04.2024 00:00:00");
+    is_ok &= check("0 0 L * *", "01.02.2024 00:00:00", "29.02.2024 00:00:00");
+    is_ok &= check("0 0 * * 1#1", "02.09.2024 00:00:00", "07.10.2024 00:00:00");
+    is_ok &= check("0 0 13 * 5", "01.09.2024 00:00:00", "06.09.2024 00:00:00");
+
+    // the expression in the time zone, GMT result
+    is_ok &= check("0 0 * * *", "15.01.2024 12:00:00", "15.01.2024 23:00:00", ztime::CET);
+    is_ok &= check("0 0 * * *", "15.07.2024 12:00:00", "15.07.2024 22:00:00", ztime::CET);
+
+    // not correct expressions
+    const char *wrong[] = {"61 * * * *", "* * *", "* * 32 * *", "* * * * 1#6", "@never", "5-1 * * * *"};
+    for (size_t i = 0; i < sizeof(wrong) / sizeof(wrong[0]); ++i) {
+        if (ztime::CronExpression(wrong[i]).is_valid()) {
+            std::cout << "error " << wrong[i] << " is valid" << std::endl;
+            is_ok = false;
+        }
+    }
+    is_ok &= check("0 0 30 2 *", "01.01.2024 00:00:00", "none");
+
+    // the next time is calculated without a search second by second
+    {
+        ztime::CronExpression cron("0 0 * * 0L");
+        ztime::timestamp_t t = ztime::get_timestamp(1, 1, 2024);
+        ztime::Timer timer;
+        const size_t n = 100000;
+        for (size_t i = 0; i < n; ++i) {
+            t = cron.next(t);
+        }
+        std::cout << "next(): " << timer.elapsed() / (double)n * 1e9 << " ns, " << ztime::get_str_date_time(t) << std::endl;
+    }
+
+    // the scheduler fires jobs on the boundaries of the wall clock
+    {
+        ztime::CronScheduler scheduler;
+        std::atomic<size_t> counter(0);
+        std::atomic<uint64_t> error_ms(0);
+        const uint64_t id = scheduler.add("* * * * * *", [&]() {
+            ++counter;
+            error_ms = std::max<uint64_t>(error_ms, ztime::get_timestamp_ms() % 1000);
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(2500));
+        scheduler.remove(id);
+        const size_t calls = counter;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+        std::cout << "scheduler calls: " << calls << ", max lateness: " << error_ms << " ms" << std::endl;
+        if (calls < 2 || calls > 3 || counter != calls || error_ms > 50 || scheduler.size() != 0) is_ok = false;
+        if (scheduler.add("61 * * * *", [](){}) != 0) is_ok = false;
+    }
+
+    std::cout << (is_ok ? "ok" : "error") << std::endl;
+    return is_ok ? 0 : 1;
+}
@@ -0,0 +1,142 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <atomic>
+#include <thread>
+#include <memory>
+#include "ztime_debounce.hpp"
+
+int main() {
+    bool is_ok = true;
+    const uint64_t start = 1704067200ULL * ztime::NS_PER_SEC;
+    const uint64_t ms = ztime::TimerService::NS_PER_MS;
+
+    // a burst is delivered once, the interval after the last touch
+    {
+        std::shared_ptr<ztime::VirtualClock> clock = std::make_shared<ztime::VirtualClock>(start);
+        ztime::TimerService service(clock);
+        std::vector<uint64_t> calls;
+        ztime::Debouncer<std::string> debouncer(50 * ms, [&](const std::string &key) {
+            if (key == "EURUSD") calls.push_back(clock->get_time_ns() - start);
+        }, service);
+        for (uint64_t t = 0; t <= 30 * ms; t += 10 * ms) {
+            clock->advance_to(start + t);
+            debouncer.touch("EURUSD");
+        }
+        if (debouncer.size() != 1) is_ok = false;
+        clock->advance_to(start + 79 * ms);
+        if (!calls.empty()) is_ok = false;
+        clock->advance_to(start + 200 * ms);
+        if (calls.size() != 1 || calls[0] != 80 * ms) is_ok = false;
+        if (debouncer.size() != 0) is_ok = false;
+
+        // a cancelled key is not delivered
+        debouncer.touch("EURUSD");
+        debouncer.cancel("EURUSD");
+        clock->advance_to(start + 400 * ms);
+        if (calls.size() != 1) is_ok = false;
+        std::cout << "debounce " << (calls.empty() ? 0 : calls[0] / ms) << " ms" << std::endl;
+    }
+
+    // the first touch at once, then at most once per interval
+    {
+        std::shared_ptr<ztime::VirtualClock> clock = std::make_shared<ztime::VirtualClock>(start);
+        ztime::TimerService service(clock);
+        std::vector<uint64_t> calls;
+        ztime::Throttler<int> throttler(50 * ms, [&](const int &) {
+            calls.push_back(clock->get_time_ns() - start);
+        }, service);
+        for (uint64_t t = 0; t < 200 * ms; t += 10 * ms) {
+            clock->advance_to(start + t);
+            throttler.touch(1);
+        }
+        clock->advance_to(start + 400 * ms);
+        const uint64_t expected[] = {0, 50 * ms, 100 * ms, 150 * ms, 200 * ms};
+        if (calls.size() != 5) is_ok = false;
+        for (size_t i = 0; i < calls.size() && i < 5; ++i) {
+            // the first period of the throttler is 1 ns
+            if (calls[i] / ms != expected[i] / ms) is_ok = false;
+        }
+        if (throttler.size() != 0) is_ok = false;
+        std::cout << "throttle " << calls.size() << " calls" << std::endl;
+    }
+
+    // 10^5 keys, the memory is released after the expiry
+    {
+        std::shared_ptr<ztime::VirtualClock> clock = std::make_shared<ztime::VirtualClock>(start);
+        ztime::TimerService service(clock, ztime::TIMER_WHEEL);
+        const size_t n = 100000;
+        size_t count = 0;
+        ztime::Debouncer<uint64_t> debouncer(100 * ms, [&](const uint64_t &) {
+            ++count;
+        }, service);
+        debouncer.reserve(n);
+        for (uint64_t t = 0; t < 10; ++t) {
+            clock->advance_to(start + t * 10 * ms);
+            for (size_t i = 0; i < n; ++i) debouncer.touch(i);
+        }
+        if (debouncer.size() != n || service.size() != n) is_ok = false;
+        clock->advance_to(start + 1000 * ms);
+        if (count != n || debouncer.size() != 0 || service.size() != 0) is_ok = false;
+        std::cout << "keys " << count << std::endl;
+    }
+
+    // the thread of a service
+    {
+        ztime::TimerService service;
+        std::atomic<size_t> count(0);
+        {
+            ztime::Debouncer<int> debouncer(20 * ms, [&](const int &) {
+                ++count;
+            }, service);
+            for (size_t j = 0; j < 5; ++j) {
+                for (int i = 0; i < 1000; ++i) debouncer.touch(i);
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+            if (count != 1000 || debouncer.size() != 0) is_ok = false;
+            for (int i = 0; i < 1000; ++i) debouncer.touch(i);
+        }
+        // the destructor forgets the pending keys
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        if (count != 1000 || service.size() != 0) is_ok = false;
+    }
+
+    // the destructor waits for a running callback whose key is already removed
+    {
+        ztime::TimerService service;
+        std::atomic<bool> is_started(false);
+        std::atomic<bool> is_finished(false);
+        std::unique_ptr<ztime::Debouncer<int>> debouncer(new ztime::Debouncer<int>(ms, [&](const int &) {
+            is_started = true;
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            is_finished = true;
+        }, service));
+        debouncer->touch(1);
+        while (!is_started) std::this_thread::yield();
+        debouncer.reset();
+        if (!is_finished) is_ok = false;
+    }
+
+    // the same after the key of the running callback is cancelled
+    {
+        ztime::TimerService service;
+        std::atomic<bool> is_started(false);
+        std::atomic<bool> is_finished(false);
+        std::unique_ptr<ztime::Throttler<int>> throttler(new ztime::Throttler<int>(ms, [&](const int &) {
+            is_started = true;
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            is_finished = true;
+        }, service));
+        throttler->touch(1);
+        while (!is_started) std::this_thread::yield();
+        throttler->cancel(1);
+        throttler.reset();
+        if (!is_finished) is_ok = false;
+        std::cout << "destroyed after the running callbacks" << std::endl;
+    }
+
+    if (is_ok) std::cout << "ok" << std::endl;
+    else std::cout << "error" << std::endl;
+    return 0;
+}
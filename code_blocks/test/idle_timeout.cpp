@@ -0,0 +1,144 @@
+#include <iostream>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include "ztime_idle_timeout.hpp"
+
+template<class T>
+double measure_ns(T func, const size_t n) {
+    auto start = std::chrono::steady_clock::now();
+    func();
+    auto stop = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(stop - start).count() / (double)n;
+}
+
+int main() {
+    bool is_ok = true;
+    const uint64_t start = 1704067200ULL * ztime::NS_PER_SEC;
+    const uint64_t ms = ztime::TimerService::NS_PER_MS;
+
+    // the expiry comes the timeout after the last activity
+    {
+        std::shared_ptr<ztime::VirtualClock> clock = std::make_shared<ztime::VirtualClock>(start);
+        ztime::TimerService service(clock);
+        std::vector<uint64_t> expiries;
+        ztime::IdleTimeout timeout(100 * ms, [&]() {
+            expiries.push_back(clock->get_time_ns() - start);
+        }, service);
+        clock->advance_to(start + 50 * ms);
+        timeout.touch();
+        clock->advance_to(start + 120 * ms);
+        timeout.touch(clock->get_time_ns());
+        clock->advance_to(start + 219 * ms);
+        if (!expiries.empty() || timeout.is_expired()) is_ok = false;
+        clock->advance_to(start + 1000 * ms);
+        if (expiries.size() != 1 || expiries[0] != 220 * ms || !timeout.is_expired()) is_ok = false;
+
+        // the expired timeout ignores activity until restart()
+        timeout.touch();
+        clock->advance_to(start + 2000 * ms);
+        if (expiries.size() != 1) is_ok = false;
+        timeout.restart();
+        clock->advance_to(start + 2050 * ms);
+        timeout.touch();
+        clock->advance_to(start + 3000 * ms);
+        if (expiries.size() != 2 || expiries[1] != 2150 * ms) is_ok = false;
+        std::cout << "expiries " << expiries.size() << std::endl;
+    }
+
+    // restart() which races with a running expiry is not lost
+    {
+        std::shared_ptr<ztime::VirtualClock> clock = std::make_shared<ztime::VirtualClock>(start);
+        ztime::TimerService service(clock);
+        std::atomic<size_t> expiries(0);
+        size_t lost = 0;
+        for (size_t i = 0; i < 2000; ++i) {
+            const uint64_t created = clock->get_time_ns();
+            ztime::IdleTimeout timeout(100 * ms, [&]() {
+                ++expiries;
+            }, service);
+            clock->advance_to(created + 60 * ms);
+            // the connection is idle, the timer expires at created + 100 ms
+            timeout.touch(created - 40 * ms);
+            std::atomic<size_t> ready(0);
+            std::thread restarter([&]() {
+                ++ready;
+                while (ready != 2) {};
+                // both orders and the race between them
+                if (i % 2) std::this_thread::yield();
+                timeout.restart();
+            });
+            ++ready;
+            while (ready != 2) {};
+            clock->advance_to(created + 100 * ms);
+            restarter.join();
+            // restart() has touched the connection less than 100 ms ago
+            if (timeout.is_expired()) ++lost;
+        }
+        std::cout << "expiries before restart " << expiries << ", lost restarts " << lost << std::endl;
+        if (lost != 0) is_ok = false;
+    }
+
+    // the timer of a busy connection wakes up once per timeout
+    {
+        std::shared_ptr<ztime::VirtualClock> clock = std::make_shared<ztime::VirtualClock>(start);
+        ztime::TimerService service(clock);
+        size_t expiries = 0;
+        ztime::IdleTimeout timeout(100 * ms, [&]() {
+            ++expiries;
+        }, service);
+        for (uint64_t t = 0; t < 1000 * ms; t += ms) {
+            clock->advance_to(start + t);
+            timeout.touch();
+        }
+        const ztime::TimerStats stats = service.get_stats();
+        std::cout << "timer calls " << stats.expirations << std::endl;
+        if (expiries != 0 || stats.expirations > 11) is_ok = false;
+    }
+
+    // connections on the thread of a service
+    {
+        ztime::TimerService service;
+        const size_t n = 1000;
+        std::atomic<size_t> expiries(0);
+        std::vector<std::unique_ptr<ztime::IdleTimeout>> timeouts;
+        for (size_t i = 0; i < n; ++i) {
+            timeouts.emplace_back(new ztime::IdleTimeout(30 * ms, [&]() {
+                ++expiries;
+            }, service));
+        }
+        for (size_t j = 0; j < 10; ++j) {
+            const uint64_t now = service.get_now();
+            for (size_t i = 0; i < n; ++i) timeouts[i]->touch(now);
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        if (expiries != 0) is_ok = false;
+        // the even connections stay active
+        for (size_t j = 0; j < 20; ++j) {
+            const uint64_t now = service.get_now();
+            for (size_t i = 0; i < n; i += 2) timeouts[i]->touch(now);
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        if (expiries != n / 2) is_ok = false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        if (expiries != n) is_ok = false;
+
+        const size_t count = 10000000;
+        const double t_touch = measure_ns([&]() {
+            for (size_t i = 0; i < count; ++i) timeouts[i % n]->touch();
+        }, count);
+        const double t_store = measure_ns([&]() {
+            const uint64_t now = service.get_now();
+            for (size_t i = 0; i < count; ++i) timeouts[i % n]->touch(now);
+        }, count);
+        std::cout << "touch " << t_touch << " ns, touch(now) " << t_store << " ns" << std::endl;
+        timeouts.clear();
+        if (service.size() != 0) is_ok = false;
+    }
+
+    if (is_ok) std::cout << "ok" << std::endl;
+    else std::cout << "error" << std::endl;
+    return 0;
+}
@@ -0,0 +1,150 @@
+#include <iostream>
+#include <memory>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include "ztime.hpp"
+#include "parts/ztime_timer_service.hpp"
+
+static std::atomic<size_t> allocations(0);
+
+__attribute__((noinline)) void *operator new(std::size_t size) {
+    ++allocations;
+    void *p = std::malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+__attribute__((noinline)) void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+__attribute__((noinline)) void operator delete(void *p, std::size_t) noexcept {
+    std::free(p);
+}
+
+struct Counter {
+    static int alive;
+    Counter() { ++alive; }
+    Counter(const Counter &) { ++alive; }
+    ~Counter() { --alive; }
+};
+
+int Counter::alive = 0;
+
+int main() {
+    bool is_ok = true;
+
+    // move-only callables, moved-from functions are empty, captures are destroyed
+    {
+        typedef ztime::InplaceFunction<int(int), 32> function_t;
+        std::unique_ptr<int> value(new int(40));
+        const size_t before = allocations;
+        function_t f([](int x) { return x + 1; });
+        function_t g(std::move(f));
+        Counter counter;
+        {
+            struct Owner {
+                std::unique_ptr<int> value;
+                Counter counter;
+                int operator()(int x) { return *value + x; }
+            };
+            Owner owner;
+            owner.value = std::move(value);
+            function_t h(std::move(owner));
+            if (h(2) != 42 || Counter::alive != 3) is_ok = false;
+            function_t k;
+            k = std::move(h);
+            if (h || !k || k(1) != 41) is_ok = false;
+        }
+        if (f || !g || g(1) != 2 || Counter::alive != 1) is_ok = false;
+        if (allocations != before) is_ok = false;
+        std::cout << "inplace function: " << g(41) << ", alive " << Counter::alive << std::endl;
+
+        bool is_thrown = false;
+        try {
+            f(1);
+        } catch (const std::bad_function_call &) {
+            is_thrown = true;
+        }
+        void (*null_ptr)() = nullptr;
+        ztime::InplaceFunction<void()> empty(null_ptr);
+        if (!is_thrown || empty) is_ok = false;
+    }
+
+    // churn of timers with large captures does not allocate callbacks, timers or commands
+    {
+        ztime::TimerService service(ztime::EXTERNAL_LOOP);
+        uint64_t data[6] = {1, 2, 3, 4, 5, 6};
+        std::unique_ptr<int> owned(new int(1));
+        service.remove(service.add([data]()->uint64_t {
+            return data[0];
+        }, ztime::TimerService::NS_PER_MS));
+        service.process_due();
+        const size_t before = allocations;
+        const size_t cycles = 1000;
+        for (size_t i = 0; i < cycles; ++i) {
+            const uint64_t id = service.add([data]()->uint64_t {
+                return data[5];
+            }, ztime::TimerService::NS_PER_MS);
+            service.reset(id);
+            service.set_period(id, 2 * ztime::TimerService::NS_PER_MS);
+            service.remove(id);
+        }
+        const double per_cycle = (double)(allocations - before) / (double)cycles;
+        std::cout << "allocations per add, reset, set_period and remove: " << per_cycle << std::endl;
+        // the command nodes are reused
+        if (per_cycle != 0) is_ok = false;
+        std::shared_ptr<int> result = std::make_shared<int>(0);
+        service.add([owned = std::move(owned), result]()->uint64_t {
+            *result = *owned;
+            return 0;
+        }, 1);
+        service.process_due();
+        if (*result != 1) is_ok = false;
+    }
+
+    // the same on the thread of a service after the warm-up
+    {
+        ztime::TimerService service;
+        uint64_t data[6] = {1, 2, 3, 4, 5, 6};
+        size_t before = 0;
+        const size_t cycles = 1000;
+        for (size_t j = 0; j < 2; ++j) {
+            before = allocations;
+            for (size_t i = 0; i < cycles; ++i) {
+                const uint64_t id = service.add([data]()->uint64_t {
+                    return data[5];
+                }, 1000 * ztime::TimerService::NS_PER_MS);
+                service.reset(id);
+                service.remove(id);
+            }
+        }
+        const size_t count = allocations - before;
+        std::cout << "allocations on the thread of a service: " << count << std::endl;
+        if (count != 0) is_ok = false;
+    }
+
+    // callbacks dispatched to a pool of threads after the warm-up
+    {
+        ztime::TimerService service(ztime::TIMER_HEAP, std::make_shared<ztime::ThreadPoolExecutor>(2));
+        std::atomic<size_t> calls(0);
+        for (size_t i = 0; i < 10; ++i) {
+            service.add([&calls]()->uint64_t {
+                ++calls;
+                return ztime::TimerService::NS_PER_MS;
+            }, ztime::TimerService::NS_PER_MS);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        const size_t before = allocations;
+        const size_t before_calls = calls;
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        const size_t count = allocations - before;
+        std::cout << "allocations of " << (calls - before_calls) << " calls on the executor: " << count << std::endl;
+        if (count != 0 || calls == before_calls) is_ok = false;
+    }
+
+    if (is_ok) std::cout << "ok" << std::endl;
+    else std::cout << "error" << std::endl;
+    return 0;
+}
@@ -0,0 +1,89 @@
+#include <iostream>
+#include <thread>
+#include <chrono>
+#include "ztime.hpp"
+
+typedef std::chrono::steady_clock clock_type;
+
+double elapsed_ms(const clock_type::time_point start) {
+    return std::chrono::duration<double, std::milli>(clock_type::now() - start).count();
+}
+
+int main() {
+    bool is_ok = true;
+
+    // an absolute deadline does not depend on the time of the call
+    {
+        const clock_type::time_point start = clock_type::now();
+        const clock_type::time_point deadline = start + std::chrono::milliseconds(20);
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        ztime::delay_until(deadline);
+        const double t = elapsed_ms(start);
+        std::cout << "delay_until 20 ms: " << t << " ms" << std::endl;
+        if (clock_type::now() < deadline || t > 30.0) is_ok = false;
+
+        // a deadline in the past returns at once
+        const clock_type::time_point past = clock_type::now();
+        ztime::delay_until(start);
+        if (elapsed_ms(past) > 5.0) is_ok = false;
+    }
+
+    // relative delays with a spin tail
+    {
+        const clock_type::time_point start = clock_type::now();
+        ztime::delay_us(2000, 200000);
+        ztime::delay_ns(3000000);
+        const double t = elapsed_ms(start);
+        std::cout << "delay_us + delay_ns 5 ms: " << t << " ms" << std::endl;
+        if (t < 5.0 || t > 15.0) is_ok = false;
+    }
+
+    // the work of the iterations does not shift the rate
+    {
+        ztime::Pacer pacer(std::chrono::milliseconds(4));
+        const clock_type::time_point start = clock_type::now();
+        const size_t n = 50;
+        for (size_t i = 0; i < n; ++i) {
+            pacer.wait();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        const double t = elapsed_ms(start);
+        std::cout << "pacer " << n << " x 4 ms: " << t << " ms, overruns " << pacer.get_overruns() << std::endl;
+        // relative sleeps would take 250 ms, a skipped deadline adds a period
+        if (t < 200.0 || t > 4.0 * (double)(n + pacer.get_overruns()) + 10.0) is_ok = false;
+        if (pacer.get_iterations() != n) is_ok = false;
+    }
+
+    // an overrun is reported and the missed deadlines are skipped
+    {
+        ztime::Pacer pacer(std::chrono::milliseconds(2));
+        const clock_type::time_point first = pacer.get_next_deadline();
+        if (pacer.wait() != 0) is_ok = false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(7));
+        const uint64_t missed = pacer.wait();
+        std::cout << "skipped " << missed << std::endl;
+        if (missed < 3 || pacer.get_overruns() != missed) is_ok = false;
+        // the loop stays on the grid of deadlines
+        const int64_t offset = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            pacer.get_next_deadline() - first).count();
+        if (offset % 2000000 != 0) is_ok = false;
+        if (pacer.get_next_deadline() <= clock_type::now()) is_ok = false;
+    }
+
+    // the catch-up mode runs the missed iterations without waiting
+    {
+        ztime::Pacer pacer(std::chrono::milliseconds(2), 0, true);
+        std::this_thread::sleep_for(std::chrono::milliseconds(9));
+        const clock_type::time_point start = clock_type::now();
+        size_t late = 0;
+        while (pacer.wait()) ++late;
+        std::cout << "caught up after " << late << " iterations, overruns " << pacer.get_overruns() << std::endl;
+        if (late < 4 || late > 8 || elapsed_ms(start) > 5.0) is_ok = false;
+        // one stall is counted once, not again by every late iteration
+        if (pacer.get_overruns() != late) is_ok = false;
+    }
+
+    if (is_ok) std::cout << "ok" << std::endl;
+    else std::cout << "error" << std::endl;
+    return 0;
+}
@@ -0,0 +1,42 @@
+#include <iostream>
+#include <ztime_session_calendar.hpp>
+
+int main() {
+    ztime::SessionCalendar calendar;
+
+    // Frankfurt: MON-FRI 09:00-17:30 CET
+    calendar.set_zone(ztime::CET);
+    calendar.add_session(ztime::MON, ztime::FRI,
+        ztime::get_second_day(9, 0, 0),
+        ztime::get_second_day(17, 30, 0));
+    calendar.add_holiday(25, 12, 2023);
+    calendar.add_half_day(29, 12, 2023, ztime::get_second_day(14, 0, 0));
+
+    calendar.compile(
+        ztime::get_timestamp(1, 12, 2023),
+        ztime::get_timestamp(31, 1, 2024));
+
+    const ztime::timestamp_t t1 = ztime::get_timestamp(20, 12, 2023, 10, 0, 0);  // 11:00 CET
+    const ztime::timestamp_t t2 = ztime::get_timestamp(25, 12, 2023, 10, 0, 0);  // holiday
+    const ztime::timestamp_t t3 = ztime::get_timestamp(29, 12, 2023, 13, 30, 0); // 14:30 CET, half-day
+
+    std::cout << "is_open " << ztime::get_str_date_time(t1) << ": " << calendar.is_open(t1) << std::endl;
+    std::cout << "is_open " << ztime::get_str_date_time(t2) << ": " << calendar.is_open(t2) << std::endl;
+    std::cout << "is_open " << ztime::get_str_date_time(t3) << ": " << calendar.is_open(t3) << std::endl;
+
+    std::cout << "next_open  " << ztime::get_str_date_time(calendar.next_open(t2)) << std::endl;
+    std::cout << "next_close " << ztime::get_str_date_time(calendar.next_close(t1)) << std::endl;
+
+    const ztime::timestamp_t week_start = ztime::get_timestamp(18, 12, 2023);
+    const ztime::timestamp_t week_stop = ztime::get_timestamp(25, 12, 2023);
+    std::cout << "trading hours 18.12-25.12: "
+        << (double)calendar.trading_seconds_between(week_start, week_stop) / 3600.0 << std::endl;
+
+    if (calendar.is_open(t1) && !calendar.is_open(t2) && !calendar.is_open(t3) &&
+        calendar.trading_seconds_between(week_start, week_stop) == 5 * 8.5 * 3600) {
+        std::cout << "ok" << std::endl;
+    } else {
+        std::cout << "error" << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,52 @@
+#include <iostream>
+#include <ztime.hpp>
+#include <parts/ztime_timer_service.hpp>
+
+int main() {
+    bool is_ok = true;
+
+    // handles of erased values are stale, slots are reused
+    {
+        ztime::SlotMap<int> slots;
+        const uint64_t a = slots.insert(1);
+        const uint64_t b = slots.insert(2);
+        if (!slots.get(a) || *slots.get(a) != 1 || *slots.get(b) != 2) is_ok = false;
+        if (!slots.erase(a) || slots.erase(a) || slots.get(a)) is_ok = false;
+        const uint64_t c = slots.insert(3);
+        std::cout << "handles: " << std::hex << a << " " << b << " " << c << std::dec << std::endl;
+        if (c == a || ztime::SlotHandle::get_index(c) != ztime::SlotHandle::get_index(a)) is_ok = false;
+        if (slots.get(a) || !slots.get(c) || *slots.get(c) != 3) is_ok = false;
+        if (slots.size() != 2 || slots.capacity() != 2) is_ok = false;
+        if (slots.contains(ztime::SlotHandle::INVALID)) is_ok = false;
+
+        for (size_t i = 0; i < 100000; ++i) {
+            slots.erase(slots.insert((int)i));
+        }
+        std::cout << "capacity after 100000 inserts: " << slots.capacity() << std::endl;
+        if (slots.capacity() != 3) is_ok = false;
+    }
+
+    // stale ids do not touch the timer which reused the slot
+    {
+        ztime::TimerService service;
+        std::atomic<size_t> counter(0);
+        const uint64_t old_id = service.add([&]()->uint64_t {
+            return 0;
+        }, 1000 * ztime::TimerService::NS_PER_MS);
+        service.remove(old_id);
+        const uint64_t id = service.add([&]()->uint64_t {
+            ++counter;
+            return 20 * ztime::TimerService::NS_PER_MS;
+        }, 20 * ztime::TimerService::NS_PER_MS);
+        service.remove(old_id);
+        service.set_period(old_id, 0);
+        std::this_thread::sleep_for(std::chrono::milliseconds(110));
+        std::cout << "reused slot: " << (ztime::SlotHandle::get_index(id) == ztime::SlotHandle::get_index(old_id))
+            << ", calls: " << counter << ", size: " << service.size() << std::endl;
+        if (id == old_id || counter < 4 || service.size() != 1) is_ok = false;
+    }
+
+    if (is_ok) std::cout << "ok" << std::endl;
+    else std::cout << "error" << std::endl;
+    return 0;
+}
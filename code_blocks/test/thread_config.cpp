@@ -0,0 +1,128 @@
+#include <iostream>
+#include <atomic>
+#include <thread>
+#include <string>
+#include <ztime_timer_event.hpp>
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#if defined(__linux__)
+std::string get_thread_name() {
+    char name[16] = {};
+    pthread_getname_np(pthread_self(), name, sizeof(name));
+    return name;
+}
+
+int get_thread_policy() {
+    int policy = 0;
+    struct sched_param param = {};
+    pthread_getschedparam(pthread_self(), &policy, &param);
+    return policy;
+}
+#endif
+
+int main() {
+    bool is_ok = true;
+#   if defined(__linux__)
+    // the name is cut to 15 characters, the thread is bound to CPU 0
+    {
+        ztime::ThreadConfig config;
+        config.name = "ztime-critical-timers";
+        config.cpus.push_back(0);
+        ztime::TimerService service;
+        if (!service.set_thread_config(config)) is_ok = false;
+
+        std::atomic<bool> is_done(false);
+        std::string name;
+        int cpu = -1;
+        service.add([&]()->uint64_t {
+            name = get_thread_name();
+            cpu = sched_getcpu();
+            is_done = true;
+            return 0;
+        }, ztime::TimerService::NS_PER_MS);
+        while (!is_done) std::this_thread::yield();
+        std::cout << "name " << name << " cpu " << cpu << std::endl;
+        if (name != "ztime-critical-" || cpu != 0) is_ok = false;
+    }
+
+    // the threads of the executor are configured too
+    {
+        ztime::ThreadConfig config;
+        config.name = "ztime-pool";
+        ztime::TimerService service(ztime::TIMER_HEAP, std::make_shared<ztime::ThreadPoolExecutor>(2));
+        if (!service.set_thread_config(config)) is_ok = false;
+
+        std::atomic<bool> is_done(false);
+        std::string name;
+        service.add([&]()->uint64_t {
+            name = get_thread_name();
+            is_done = true;
+            return 0;
+        }, ztime::TimerService::NS_PER_MS);
+        while (!is_done) std::this_thread::yield();
+        if (name != "ztime-pool") is_ok = false;
+    }
+
+    // SCHED_FIFO needs privileges, the result tells if it was applied
+    {
+        ztime::ThreadConfig config;
+        config.policy = ztime::THREAD_SCHED_FIFO;
+        config.priority = 10;
+        ztime::TimerService service;
+        const bool is_applied = service.set_thread_config(config);
+
+        std::atomic<bool> is_done(false);
+        int policy = -1;
+        service.add([&]()->uint64_t {
+            policy = get_thread_policy();
+            is_done = true;
+            return 0;
+        }, ztime::TimerService::NS_PER_MS);
+        while (!is_done) std::this_thread::yield();
+        std::cout << "SCHED_FIFO " << (is_applied ? "applied" : "not permitted") << std::endl;
+        if (is_applied != (policy == SCHED_FIFO)) is_ok = false;
+    }
+
+    // a service without a thread has nothing to configure
+    {
+        ztime::TimerService service(ztime::EXTERNAL_LOOP);
+        if (service.set_thread_config(ztime::ThreadConfig())) is_ok = false;
+    }
+
+    // the configuration of TimerEvent waits for the thread of the index
+    {
+        ztime::ThreadConfig config;
+        config.name = "ztime-event-5";
+        if (!ztime::TimerEvent::set_thread_config(config, 5)) is_ok = false;
+
+        ztime::TimerEvent timer_event;
+        std::atomic<bool> is_done(false);
+        std::string name;
+        timer_event.add([&]()->size_t {
+            name = get_thread_name();
+            is_done = true;
+            return 0;
+        }, 1, 5);
+        while (!is_done) std::this_thread::yield();
+        if (name != "ztime-event-5") is_ok = false;
+
+        config.name = "ztime-event-x";
+        if (!ztime::TimerEvent::set_thread_config(config, 5)) is_ok = false;
+        is_done = false;
+        timer_event.add([&]()->size_t {
+            name = get_thread_name();
+            is_done = true;
+            return 0;
+        }, 1, 5);
+        while (!is_done) std::this_thread::yield();
+        if (name != "ztime-event-x") is_ok = false;
+    }
+#   endif
+
+    if (is_ok) std::cout << "ok" << std::endl;
+    else std::cout << "error" << std::endl;
+    return 0;
+}
@@ -0,0 +1,170 @@
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <atomic>
+#include <thread>
+#include <ztime_timer_event.hpp>
+
+template<class T>
+double measure_ms(T func) {
+    auto start = std::chrono::steady_clock::now();
+    func();
+    auto stop = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(stop - start).count();
+}
+
+/** \brief Expire all nodes of the queue, the deadlines must not decrease
+ */
+bool check_order(ztime::TimerQueue &queue, const size_t expected) {
+    size_t fired = 0;
+    uint64_t last = 0;
+    while (ztime::TimerNode *node = queue.pop_due(ztime::TimerQueue::NO_DEADLINE - 1)) {
+        if (node->deadline < last) return false;
+        last = node->deadline;
+        ++fired;
+    }
+    return fired == expected;
+}
+
+/** \brief Benchmark of push vs update_many and erase vs erase_many of the heap
+ */
+bool benchmark_heap(const size_t n) {
+    const uint64_t ms = 1000000;
+    std::mt19937_64 gen(n);
+    std::uniform_int_distribution<uint64_t> delay(1, 600000);
+    std::vector<ztime::TimerNode> nodes(n);
+    std::vector<ztime::TimerNode*> pointers(n);
+    for (size_t i = 0; i < n; ++i) {
+        nodes[i].deadline = delay(gen) * ms;
+        pointers[i] = &nodes[i];
+    }
+
+    bool is_ok = true;
+    ztime::TimerHeap heap;
+    const double t_push = measure_ms([&]{
+        for (size_t i = 0; i < n; ++i) heap.push(pointers[i]);
+    });
+    const double t_erase = measure_ms([&]{
+        for (size_t i = 0; i < n; i += 2) heap.erase(pointers[i]);
+    });
+    is_ok = check_order(heap, n / 2) && is_ok;
+
+    std::vector<ztime::TimerNode*> odd;
+    for (size_t i = 0; i < n; i += 2) odd.push_back(pointers[i]);
+    const double t_push_many = measure_ms([&]{
+        heap.update_many(pointers.data(), pointers.size());
+    });
+    const double t_erase_many = measure_ms([&]{
+        heap.erase_many(odd.data(), odd.size());
+    });
+    is_ok = check_order(heap, n / 2) && is_ok;
+
+    // a small batch into a large heap goes one by one
+    heap.update_many(pointers.data(), pointers.size());
+    for (size_t i = 0; i < 10; ++i) nodes[i].deadline = delay(gen) * ms;
+    heap.update_many(pointers.data(), 10);
+    is_ok = check_order(heap, n) && is_ok;
+
+    std::cout << "heap n = " << n
+        << " push: " << t_push
+        << " ms, update_many: " << t_push_many
+        << " ms, erase: " << t_erase
+        << " ms, erase_many: " << t_erase_many
+        << " ms" << std::endl;
+    return is_ok;
+}
+
+/** \brief Benchmark of add vs add_many and remove vs remove_many of the service
+ */
+bool benchmark_service(const ztime::TimerBackend backend, const char *name, const size_t n) {
+    const uint64_t period = 600000 * ztime::TimerService::NS_PER_MS;
+    bool is_ok = true;
+    ztime::TimerService service(backend);
+
+    std::vector<uint64_t> ids(n);
+    const double t_add = measure_ms([&]{
+        for (size_t i = 0; i < n; ++i) {
+            ids[i] = service.add([]()->uint64_t { return 0; }, period + i);
+        }
+    });
+    const double t_remove = measure_ms([&]{
+        for (size_t i = 0; i < n; ++i) service.remove(ids[i]);
+    });
+    if (service.size() != 0) is_ok = false;
+
+    std::vector<ztime::TimerService::TimerSpec> specs(n);
+    for (size_t i = 0; i < n; ++i) {
+        specs[i] = ztime::TimerService::TimerSpec([]()->uint64_t { return 0; }, period + i);
+    }
+    const double t_add_many = measure_ms([&]{
+        ids = service.add_many(specs);
+    });
+    if (ids.size() != n || service.size() != n) is_ok = false;
+    const double t_remove_many = measure_ms([&]{
+        service.remove_many(ids);
+    });
+    if (service.size() != 0 || service.get_stats().size != 0) is_ok = false;
+
+    std::cout << name << " service n = " << n
+        << " add: " << t_add
+        << " ms, add_many: " << t_add_many
+        << " ms, remove: " << t_remove
+        << " ms, remove_many: " << t_remove_many
+        << " ms" << std::endl;
+    return is_ok;
+}
+
+int main() {
+    bool is_ok = true;
+    const size_t n = 100000;
+    is_ok = benchmark_heap(n) && is_ok;
+    is_ok = benchmark_service(ztime::TIMER_HEAP, "heap ", n) && is_ok;
+    is_ok = benchmark_service(ztime::TIMER_WHEEL, "wheel", n) && is_ok;
+
+    // timers added at once fire, timers removed at once do not
+    {
+        ztime::TimerService service;
+        std::atomic<size_t> counter(0);
+        std::vector<ztime::TimerService::TimerSpec> specs;
+        for (size_t i = 0; i < 2000; ++i) {
+            const uint64_t period = (i % 2 ? 20 : 200) * ztime::TimerService::NS_PER_MS;
+            specs.emplace_back([&counter]()->uint64_t {
+                ++counter;
+                return 0;
+            }, period);
+        }
+        std::vector<uint64_t> ids = service.add_many(specs);
+        std::vector<uint64_t> removed;
+        for (size_t i = 0; i < ids.size(); i += 2) removed.push_back(ids[i]);
+        // repeated and stale ids are ignored
+        removed.push_back(ids[0]);
+        removed.push_back(ids[1] + (1ULL << 32));
+        service.remove_many(removed);
+        std::this_thread::sleep_for(std::chrono::milliseconds(400));
+        if (counter != 1000 || service.size() != 0) is_ok = false;
+    }
+
+    // TimerEvent
+    {
+        std::atomic<size_t> counter(0);
+        ztime::TimerEvent event;
+        std::vector<std::function<size_t()>> callbacks;
+        for (size_t i = 0; i < 1000; ++i) {
+            callbacks.push_back([&counter]()->size_t {
+                ++counter;
+                return 0;
+            });
+        }
+        std::vector<uint64_t> fast = event.add_many(callbacks, 20, 2);
+        std::vector<uint64_t> slow = event.add_many(callbacks, 200, 2);
+        if (fast.size() != 1000 || slow.size() != 1000) is_ok = false;
+        event.remove_many(slow);
+        std::this_thread::sleep_for(std::chrono::milliseconds(400));
+        if (counter != 1000) is_ok = false;
+    }
+
+    if (is_ok) std::cout << "ok" << std::endl;
+    else std::cout << "error" << std::endl;
+    return 0;
+}
@@ -0,0 +1,105 @@
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <ztime_timer_event.hpp>
+
+template<class T>
+double measure_ms(T func) {
+    auto start = std::chrono::steady_clock::now();
+    func();
+    auto stop = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(stop - start).count();
+}
+
+int main() {
+    const size_t num_producers = 32;
+    const size_t timers_per_producer = 1000;
+    const size_t resets_per_producer = 100000;
+    bool is_ok = true;
+
+    // timeouts of connections are refreshed by many threads at once
+    std::atomic<size_t> fired(0);
+    ztime::TimerService service;
+    std::vector<std::vector<uint64_t>> ids(num_producers);
+
+    const double t_add = measure_ms([&]{
+        std::vector<std::thread> producers;
+        for (size_t p = 0; p < num_producers; ++p) {
+            producers.emplace_back([&, p] {
+                for (size_t i = 0; i < timers_per_producer; ++i) {
+                    ids[p].push_back(service.add([&]()->uint64_t {
+                        ++fired;
+                        return 0;
+                    }, 10000 * ztime::TimerService::NS_PER_MS));
+                }
+            });
+        }
+        for (auto &producer : producers) producer.join();
+    });
+
+    const double t_reset = measure_ms([&]{
+        std::vector<std::thread> producers;
+        for (size_t p = 0; p < num_producers; ++p) {
+            producers.emplace_back([&, p] {
+                for (size_t i = 0; i < resets_per_producer; ++i) {
+                    service.reset(ids[p][i % timers_per_producer]);
+                }
+            });
+        }
+        for (auto &producer : producers) producer.join();
+    });
+
+    const double t_cancel = measure_ms([&]{
+        std::vector<std::thread> producers;
+        for (size_t p = 0; p < num_producers; ++p) {
+            producers.emplace_back([&, p] {
+                for (size_t i = 0; i < timers_per_producer; ++i) {
+                    service.cancel(ids[p][i]);
+                }
+            });
+        }
+        for (auto &producer : producers) producer.join();
+    });
+    service.remove_all();
+
+    const double num_resets = (double)(num_producers * resets_per_producer);
+    std::cout << num_producers << " producers" << std::endl;
+    std::cout << "add: " << t_add << " ms" << std::endl;
+    std::cout << "reset: " << t_reset << " ms, " << (num_resets / t_reset * 1000.0) << " ops/s" << std::endl;
+    std::cout << "cancel: " << t_cancel << " ms" << std::endl;
+    if (fired != 0 || service.size() != 0) is_ok = false;
+
+    // the same load through TimerEvent
+    {
+        ztime::TimerEvent event;
+        std::vector<std::vector<size_t>> indexes(num_producers);
+        for (size_t p = 0; p < num_producers; ++p) {
+            for (size_t i = 0; i < timers_per_producer; ++i) {
+                indexes[p].push_back(event.add([&]()->size_t {
+                    ++fired;
+                    return 0;
+                }, 10000, 3));
+            }
+        }
+        const double t_event_reset = measure_ms([&]{
+            std::vector<std::thread> producers;
+            for (size_t p = 0; p < num_producers; ++p) {
+                producers.emplace_back([&, p] {
+                    for (size_t i = 0; i < resets_per_producer; ++i) {
+                        event.reset(indexes[p][i % timers_per_producer]);
+                    }
+                });
+            }
+            for (auto &producer : producers) producer.join();
+        });
+        std::cout << "TimerEvent reset: " << t_event_reset << " ms, "
+            << (num_resets / t_event_reset * 1000.0) << " ops/s" << std::endl;
+    }
+    if (fired != 0) is_ok = false;
+
+    if (is_ok) std::cout << "ok" << std::endl;
+    else std::cout << "error" << std::endl;
+    return 0;
+}
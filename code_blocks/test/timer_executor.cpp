@@ -0,0 +1,140 @@
+#include <iostream>
+#include <ztime_timer_event.hpp>
+#include <ztime.hpp>
+
+template<class T>
+double measure_ms(T func) {
+    auto start = std::chrono::steady_clock::now();
+    func();
+    auto stop = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(stop - start).count();
+}
+
+/** \brief A slow callback must not block add/remove and other events of the handler
+ */
+bool test(std::shared_ptr<ztime::Executor> executor, const char *name, const size_t thread_index) {
+    ztime::TimerEvent::set_executor(executor, thread_index);
+    std::atomic<size_t> fast(0);
+    std::atomic<size_t> slow(0);
+    double t_add = 0;
+    double t_remove = 0;
+    {
+        ztime::TimerEvent event;
+        event.add([&]()->size_t {
+            ++slow;
+            std::this_thread::sleep_for(std::chrono::milliseconds(500));
+            return 1000;
+        }, 10, thread_index);
+        event.add([&]()->size_t {
+            ++fast;
+            return 50;
+        }, 50, thread_index);
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        // the slow callback is running now
+        size_t index = 0;
+        t_add = measure_ms([&]{
+            index = event.add([&]()->size_t {
+                return 100;
+            }, 100, thread_index);
+        });
+        t_remove = measure_ms([&]{
+            event.remove(index);
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    }
+    std::cout << name
+        << " add: " << t_add << " ms, remove: " << t_remove
+        << " ms, fast: " << fast << ", slow: " << slow << std::endl;
+    return t_add < 10 && t_remove < 10 && fast >= 8 && slow == 1;
+}
+
+int main() {
+    bool is_ok = true;
+    is_ok = test(std::make_shared<ztime::ThreadPoolExecutor>(2), "thread pool", 1) && is_ok;
+    is_ok = test(std::make_shared<ztime::WorkStealingExecutor>(2), "work stealing", 2) && is_ok;
+
+    // the next delay returned by the callback is kept
+    {
+        std::atomic<size_t> counter(0);
+        ztime::Timer timer;
+        ztime::TimerEvent event;
+        event.add([&]()->size_t {
+            ++counter;
+            return counter < 3 ? 100 : 0;
+        }, 100, 2);
+        std::this_thread::sleep_for(std::chrono::milliseconds(450));
+        std::cout << "counter: " << counter << std::endl;
+        if (counter != 3) is_ok = false;
+    }
+
+    // a new delay returned by the callback keeps the cadence of the original TimerEvent
+    {
+        const uint64_t start = 1704067200ULL * ztime::NS_PER_SEC;
+        std::shared_ptr<ztime::VirtualClock> clock = std::make_shared<ztime::VirtualClock>(start);
+        ztime::TimerEvent::set_clock(clock, 6);
+        std::vector<uint64_t> calls;
+        {
+            ztime::TimerEvent event;
+            event.add([&]()->size_t {
+                calls.push_back((clock->get_time_ns() - start) / ztime::TimerService::NS_PER_MS);
+                return 300;
+            }, 100, 6);
+            clock->advance_to(start + 1000 * ztime::TimerService::NS_PER_MS);
+        }
+        ztime::TimerEvent::set_clock(nullptr, 6);
+        // the next start is the previous start plus the new delay
+        const uint64_t expected[] = {100, 600, 900};
+        if (calls.size() != 3) is_ok = false;
+        for (size_t i = 0; i < calls.size() && i < 3; ++i) {
+            if (calls[i] != expected[i]) is_ok = false;
+        }
+        std::cout << "new period calls: " << calls.size() << std::endl;
+    }
+
+    // slow callbacks placed automatically run in parallel, pinned ones wait for each other
+    for (size_t a = 0; a < 2; ++a) {
+        const size_t thread_index = a ? ztime::TimerEvent::AUTO : 3;
+        if (a) ztime::TimerEvent::set_executor(std::make_shared<ztime::WorkStealingExecutor>(4), thread_index);
+        std::atomic<size_t> counter(0);
+        {
+            ztime::TimerEvent event;
+            for (size_t i = 0; i < 4; ++i) {
+                event.add([&]()->size_t {
+                    ++counter;
+                    std::this_thread::sleep_for(std::chrono::milliseconds(40));
+                    return 50;
+                }, 50, thread_index);
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(520));
+        }
+        std::cout << (a ? "auto" : "pinned") << " calls: " << counter << std::endl;
+        if (a && counter < 32) is_ok = false;
+        if (!a && counter > 16) is_ok = false;
+    }
+
+    // remove_all() of an idle thread does not orphan an event which is being added to it
+    {
+        const size_t thread_index = 5;
+        std::atomic<size_t> orphaned(0);
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < 4; ++t) {
+            threads.emplace_back([&]() {
+                for (size_t i = 0; i < 5000; ++i) {
+                    ztime::TimerEvent event;
+                    event.add([]()->size_t { return 10000; }, 10000, thread_index);
+                    // the event must be on the handler of the thread index
+                    if (!ztime::TimerEvent::get_stats(thread_index).size) ++orphaned;
+                    event.remove_all();
+                }
+            });
+        }
+        for (size_t t = 0; t < threads.size(); ++t) threads[t].join();
+        std::cout << "orphaned events: " << orphaned << std::endl;
+        if (orphaned) is_ok = false;
+    }
+
+    if (is_ok) std::cout << "ok" << std::endl;
+    else std::cout << "error" << std::endl;
+    return 0;
+}
@@ -0,0 +1,74 @@
+#include <iostream>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "ztime.hpp"
+#include "parts/ztime_timer_service.hpp"
+#if defined(__linux__)
+#include <sys/epoll.h>
+#include <unistd.h>
+#endif
+
+int main() {
+    bool is_ok = true;
+#   if defined(__linux__)
+    ztime::TimerService service(ztime::EXTERNAL_LOOP);
+    const int epoll_fd = epoll_create1(0);
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, service.get_fd(), &event);
+
+    const std::thread::id loop_id = std::this_thread::get_id();
+    std::atomic<bool> is_loop_thread(true);
+    size_t fast = 0, slow = 0, other = 0, wakeups = 0;
+    service.add([&]()->uint64_t {
+        if (std::this_thread::get_id() != loop_id) is_loop_thread = false;
+        ++fast;
+        return 10 * ztime::TimerService::NS_PER_MS;
+    }, 10 * ztime::TimerService::NS_PER_MS);
+    const uint64_t slow_id = service.add([&]()->uint64_t {
+        ++slow;
+        return 25 * ztime::TimerService::NS_PER_MS;
+    }, 25 * ztime::TimerService::NS_PER_MS);
+
+    // timers added by another thread wake the loop up
+    std::thread producer([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        service.add([&]()->uint64_t {
+            if (std::this_thread::get_id() != loop_id) is_loop_thread = false;
+            ++other;
+            return 0;
+        }, 5 * ztime::TimerService::NS_PER_MS);
+    });
+
+    const uint64_t end = ztime::TimerService::now_ns() + 205 * ztime::TimerService::NS_PER_MS;
+    while (ztime::TimerService::now_ns() < end) {
+        struct epoll_event events[4];
+        const int n = epoll_wait(epoll_fd, events, 4, 5);
+        if (n > 0) {
+            ++wakeups;
+            service.process_due();
+        }
+    }
+    producer.join();
+    const size_t fast_main = fast;
+    service.remove(slow_id);
+    const size_t slow_removed = slow;
+    for (int i = 0; i < 5; ++i) {
+        struct epoll_event events[4];
+        if (epoll_wait(epoll_fd, events, 4, 10) > 0) service.process_due();
+    }
+    close(epoll_fd);
+
+    std::cout << "fast " << fast_main << ", slow " << slow << ", other " << other
+        << ", wake-ups " << wakeups << std::endl;
+    if (fast_main < 18 || fast_main > 21 || fast <= fast_main || slow_removed < 7 || slow_removed > 9 || slow != slow_removed) is_ok = false;
+    if (other != 1 || !is_loop_thread) is_ok = false;
+    // the descriptor is not readable between deadlines
+    if (wakeups > fast_main + slow + 3) is_ok = false;
+#   endif
+
+    if (is_ok) std::cout << "ok" << std::endl;
+    else std::cout << "error" << std::endl;
+    return 0;
+}
@@ -0,0 +1,61 @@
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <ztime.hpp>
+#include <ztime_timer_event.hpp>
+
+/** \brief Jitter of the intervals between the calls
+ * \return Percentile 0.99 of the deviation of the intervals from the period in us
+ */
+uint64_t get_p99_us(const std::vector<uint64_t> &calls, const uint64_t period) {
+    std::vector<uint64_t> jitter;
+    for (size_t i = 1; i < calls.size(); ++i) {
+        const uint64_t interval = calls[i] - calls[i - 1];
+        jitter.push_back(interval > period ? interval - period : period - interval);
+    }
+    std::sort(jitter.begin(), jitter.end());
+    return jitter.empty() ? 0 : jitter[jitter.size() * 99 / 100] / 1000;
+}
+
+int main() {
+    bool is_ok = true;
+    const size_t n = 2000;
+    const uint64_t period = 250000;
+
+    // TimerEvent with a period in us, without and with the busy-spin tail
+    for (size_t s = 0; s < 2; ++s) {
+        const std::chrono::microseconds spin(s ? 50 : 0);
+        std::vector<uint64_t> calls;
+        calls.reserve(n);
+        {
+            ztime::TimerEvent timer_event;
+            timer_event.add([&]() {
+                calls.push_back(ztime::TimerService::now_ns());
+                return calls.size() < n ? std::chrono::nanoseconds(period) : std::chrono::nanoseconds(0);
+            }, std::chrono::microseconds(250), 0, spin);
+            std::this_thread::sleep_for(std::chrono::nanoseconds(period * n + 50000000));
+        }
+        const uint64_t p99 = get_p99_us(calls, period);
+        std::cout << "TimerEvent 250 us, spin " << spin.count() << " us: calls " << calls.size()
+            << ", p99 jitter " << p99 << " us" << std::endl;
+        if (calls.size() < n * 9 / 10) is_ok = false;
+        if (s && p99 >= 100) is_ok = false;
+    }
+
+    // Timer with a period in us
+    {
+        std::atomic<size_t> counter(0);
+        ztime::Timer timer;
+        timer.create_event(std::chrono::microseconds(500), ztime::Timer::TimerMode::STRICT_INTERVAL, [&]() {
+            ++counter;
+        }, std::chrono::microseconds(50));
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        timer.stop_event();
+        std::cout << "Timer 500 us calls: " << counter << ", period_ms: " << timer.period_ms << std::endl;
+        if (counter < 180 || counter > 201) is_ok = false;
+        if (timer.period_ms != 0 || timer.get_period() != std::chrono::microseconds(500)) is_ok = false;
+    }
+
+    std::cout << (is_ok ? "ok" : "error") << std::endl;
+    return is_ok ? 0 : 1;
+}
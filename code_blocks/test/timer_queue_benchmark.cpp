@@ -0,0 +1,98 @@
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <ztime_timer_event.hpp>
+
+struct TestNode : public ztime::TimerNode {
+    uint64_t expected = 0;
+};
+
+template<class T>
+double measure_ms(T func) {
+    auto start = std::chrono::steady_clock::now();
+    func();
+    auto stop = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(stop - start).count();
+}
+
+/** \brief Benchmark of add, reset, remove and expiration of n timers
+ */
+bool benchmark(ztime::TimerQueue &queue, const char *name, const size_t n) {
+    const uint64_t ms = 1000000;
+    std::mt19937_64 gen(n);
+    std::uniform_int_distribution<uint64_t> delay(1, 600000); // up to 10 minutes
+    std::vector<TestNode> nodes(n);
+
+    const double t_add = measure_ms([&]{
+        for (size_t i = 0; i < n; ++i) {
+            nodes[i].deadline = delay(gen) * ms;
+            queue.push(&nodes[i]);
+        }
+    });
+    const double t_reset = measure_ms([&]{
+        for (size_t i = 0; i < n; ++i) {
+            nodes[i].deadline = delay(gen) * ms;
+            queue.update(&nodes[i]);
+        }
+    });
+    const double t_remove = measure_ms([&]{
+        for (size_t i = 0; i < n; i += 2) {
+            queue.erase(&nodes[i]);
+        }
+    });
+
+    // expiration, time goes in steps of 1 ms
+    bool is_ok = true;
+    size_t fired = 0;
+    const double t_expire = measure_ms([&]{
+        for (uint64_t now = 0; !queue.empty(); now += ms) {
+            while (ztime::TimerNode *node = queue.pop_due(now)) {
+                if (node->deadline > now || node->deadline + ms <= now) is_ok = false;
+                ++fired;
+            }
+        }
+    });
+    if (fired != n / 2) is_ok = false;
+
+    std::cout << name << " n = " << n
+        << " add: " << t_add
+        << " ms, reset: " << t_reset
+        << " ms, remove: " << t_remove
+        << " ms, expire: " << t_expire
+        << " ms" << std::endl;
+    return is_ok;
+}
+
+int main() {
+    bool is_ok = true;
+    for (size_t n = 1000; n <= 1000000; n *= 10) {
+        ztime::TimerHeap heap;
+        ztime::TimerWheel wheel;
+        is_ok = benchmark(heap, "heap ", n) && is_ok;
+        is_ok = benchmark(wheel, "wheel", n) && is_ok;
+    }
+
+    // TimerEvent with the wheel backend
+    std::atomic<size_t> counter(0);
+    {
+        ztime::TimerEvent::set_backend(ztime::TIMER_WHEEL, 1);
+        ztime::TimerEvent event;
+        const size_t n = 100000;
+        const double t_add = measure_ms([&]{
+            for (size_t i = 0; i < n; ++i) {
+                event.add([&]()->size_t {
+                    ++counter;
+                    return 0;
+                }, 10 + i % 90, 1);
+            }
+        });
+        std::cout << "TimerEvent wheel add " << n << ": " << t_add << " ms" << std::endl;
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        if (counter != n) is_ok = false;
+    }
+
+    if (is_ok) std::cout << "ok" << std::endl;
+    else std::cout << "error" << std::endl;
+    return 0;
+}
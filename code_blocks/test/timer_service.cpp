@@ -0,0 +1,181 @@
+#include <iostream>
+#include <set>
+#include <ztime.hpp>
+#include <parts/ztime_timer_service.hpp>
+
+int main() {
+    bool is_ok = true;
+
+    // hundreds of timers are served by a few threads
+    {
+        const size_t n = 200;
+        std::mutex threads_mutex;
+        std::set<std::thread::id> threads;
+        std::atomic<size_t> counter(0);
+        {
+            std::vector<std::unique_ptr<ztime::Timer>> timers;
+            for (size_t i = 0; i < n; ++i) {
+                timers.emplace_back(new ztime::Timer(10, ztime::Timer::TimerMode::STRICT_INTERVAL, [&]() {
+                    ++counter;
+                    std::lock_guard<std::mutex> lock(threads_mutex);
+                    threads.insert(std::this_thread::get_id());
+                }));
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(505));
+        }
+        const size_t calls = counter;
+        std::cout << "STRICT_INTERVAL calls: " << calls << ", threads: " << threads.size() << std::endl;
+        if (calls < n * 45 || calls > n * 51 || threads.size() > 4) is_ok = false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        if (counter != calls) is_ok = false;
+    }
+
+    // UNSTABLE_INTERVAL counts the period from the end of the callback
+    {
+        std::atomic<size_t> counter(0);
+        ztime::Timer timer(20, ztime::Timer::TimerMode::UNSTABLE_INTERVAL, [&]() {
+            ++counter;
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(410));
+        timer.stop_event();
+        std::cout << "UNSTABLE_INTERVAL calls: " << counter << std::endl;
+        if (counter < 9 || counter > 10) is_ok = false;
+    }
+
+    // ONE_SHOT_AFTER_INTERVAL is not called while it is reset
+    {
+        std::atomic<size_t> counter(0);
+        ztime::Timer timer(100, ztime::Timer::TimerMode::ONE_SHOT_AFTER_INTERVAL, [&]() {
+            ++counter;
+        });
+        for (size_t i = 0; i < 5; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            timer.reset_event();
+        }
+        const size_t before = counter;
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        const size_t once = counter;
+        timer.reset_event();
+        std::this_thread::sleep_for(std::chrono::milliseconds(150));
+        std::cout << "ONE_SHOT_AFTER_INTERVAL calls: " << before << " " << once << " " << counter << std::endl;
+        if (before != 0 || once != 1 || counter != 2) is_ok = false;
+    }
+
+    // reset_event does not restart the periodic modes
+    {
+        std::atomic<size_t> counter(0);
+        ztime::Timer timer(40, ztime::Timer::TimerMode::STRICT_INTERVAL, [&]() {
+            ++counter;
+        });
+        for (size_t i = 0; i < 10; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            timer.reset_event();
+        }
+        timer.stop_event();
+        std::cout << "STRICT_INTERVAL calls after reset_event: " << counter << std::endl;
+        if (counter < 4) is_ok = false;
+    }
+
+    // the period may be set after the creation
+    {
+        std::atomic<size_t> counter(0);
+        ztime::Timer timer([&]() {
+            ++counter;
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        const size_t before = counter;
+        timer.period_ms = 20;
+        std::this_thread::sleep_for(std::chrono::milliseconds(110));
+        timer.period_ms = 0;
+        const size_t after = counter;
+        std::this_thread::sleep_for(std::chrono::milliseconds(60));
+        std::cout << "period_ms calls: " << before << " " << after << " " << counter << std::endl;
+        if (before != 0 || after < 4 || after > 7 || counter != after) is_ok = false;
+    }
+
+    // period_ms keeps the interface of std::atomic<uint32_t>
+    {
+        std::atomic<size_t> counter(0);
+        ztime::Timer timer([&]() {
+            ++counter;
+        });
+        if (timer.period_ms.fetch_add(10) != 0 || timer.period_ms != 10) is_ok = false;
+        timer.period_ms += 5;
+        ++timer.period_ms;
+        if (timer.period_ms-- != 16 || timer.period_ms != 15) is_ok = false;
+        uint32_t expected = 10;
+        if (timer.period_ms.compare_exchange_strong(expected, 40) || expected != 15) is_ok = false;
+        if (!timer.period_ms.compare_exchange_strong(expected, 20)) is_ok = false;
+        if (timer.get_period() != std::chrono::milliseconds(20)) is_ok = false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(110));
+        if (timer.period_ms.exchange(0) != 20) is_ok = false;
+        const size_t after = counter;
+        std::this_thread::sleep_for(std::chrono::milliseconds(60));
+        std::cout << "period_ms atomic calls: " << after << " " << counter << std::endl;
+        if (after < 4 || after > 7 || counter != after) is_ok = false;
+    }
+
+    // timers with overlapping slack windows share wake-ups
+    for (size_t s = 0; s < 2; ++s) {
+        const uint64_t slack = s ? 40 * ztime::TimerService::NS_PER_MS : 0;
+        std::atomic<size_t> counter(0);
+        ztime::TimerStats stats;
+        {
+            ztime::TimerService service;
+            for (size_t i = 0; i < 20; ++i) {
+                service.add([&]()->uint64_t {
+                    ++counter;
+                    return 100 * ztime::TimerService::NS_PER_MS;
+                }, 100 * ztime::TimerService::NS_PER_MS, ztime::FIXED_RATE, 0, slack);
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(590));
+            stats = service.get_stats();
+        }
+        std::cout << "slack " << slack / ztime::TimerService::NS_PER_MS
+            << " ms: calls " << counter
+            << ", batches " << stats.batches
+            << ", saved wake-ups " << stats.get_saved_wakeups()
+            << ", coalesced " << stats.coalesced << std::endl;
+        if (counter < 100 || stats.expirations != counter) is_ok = false;
+        if (!s && stats.batches < counter / 2) is_ok = false;
+        if (s && stats.batches > counter / 5) is_ok = false;
+    }
+
+    // histograms of lateness and execution time, skipped periods
+    {
+        ztime::Histogram histogram;
+        for (uint64_t i = 0; i < 100; ++i) {
+            histogram.record(i < 90 ? 1000 : 1000000);
+        }
+        const ztime::HistogramSnapshot snapshot = histogram.get_snapshot();
+        if (snapshot.count != 100 || snapshot.max != 1000000) is_ok = false;
+        if (snapshot.get_percentile(0.5) != 1023 || snapshot.get_percentile(0.99) != 1000000) is_ok = false;
+        if (ztime::Histogram::get_bucket(0) != 0 || ztime::Histogram::get_bucket(1) != 1 ||
+            ztime::Histogram::get_bucket(1024) != 11) is_ok = false;
+
+        ztime::TimerStats stats;
+        {
+            ztime::TimerService service;
+            service.add([&]()->uint64_t {
+                std::this_thread::sleep_for(std::chrono::milliseconds(25));
+                return 10 * ztime::TimerService::NS_PER_MS;
+            }, 10 * ztime::TimerService::NS_PER_MS, ztime::FIXED_RATE);
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+            stats = service.get_stats();
+        }
+        std::cout << "histograms: calls " << stats.duration.count
+            << ", duration p50 " << stats.duration.get_percentile(0.5)
+            << " ns, lateness p50 " << stats.lateness.get_percentile(0.5)
+            << " ns, skipped " << stats.skipped
+            << ", size " << stats.size << std::endl;
+        if (stats.duration.count < 3 || stats.lateness.count != stats.duration.count) is_ok = false;
+        if (stats.duration.get_percentile(0.5) < 20 * ztime::TimerService::NS_PER_MS) is_ok = false;
+        if (stats.skipped < stats.duration.count - 1 || stats.size != 1) is_ok = false;
+    }
+
+    if (is_ok) std::cout << "ok" << std::endl;
+    else std::cout << "error" << std::endl;
+    return 0;
+}
@@ -0,0 +1,94 @@
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include "ztime.hpp"
+#include "parts/ztime_timer_service.hpp"
+
+int main() {
+    bool is_ok = true;
+    const uint64_t start = 1704067200ULL * ztime::NS_PER_SEC; // 2024-01-01
+    const uint64_t second = ztime::NS_PER_SEC;
+    const uint64_t minute = 60 * second;
+
+    // a year of minute bars and hourly timers without real sleeping
+    {
+        std::shared_ptr<ztime::VirtualClock> clock = std::make_shared<ztime::VirtualClock>(start);
+        ztime::TimerService service_a(clock);
+        ztime::TimerService service_b(clock, ztime::TIMER_WHEEL);
+        std::vector<uint64_t> calls;
+        uint64_t minutes = 0, hours = 0, days = 0;
+        bool is_order = true;
+        uint64_t last = 0;
+        auto check = [&]() {
+            const uint64_t now = clock->get_time_ns();
+            if (now < last) is_order = false;
+            last = now;
+        };
+        service_a.add([&]()->uint64_t {
+            check();
+            if ((clock->get_time_ns() - start) % minute) is_order = false;
+            ++minutes;
+            return minute;
+        }, minute, ztime::FIXED_RATE);
+        service_b.add([&]()->uint64_t {
+            check();
+            ++hours;
+            return 60 * minute;
+        }, 60 * minute, ztime::FIXED_RATE);
+        const uint64_t id = service_a.add([&]()->uint64_t {
+            check();
+            ++days;
+            return 24 * 60 * minute;
+        }, 24 * 60 * minute, ztime::FIXED_DELAY);
+
+        const auto real_start = std::chrono::steady_clock::now();
+        // the replay feeds ticks of data, timers fire in between
+        for (uint64_t t = start; t < start + 365 * 24 * 60 * minute; t += 7 * minute + 13) {
+            clock->advance_to(t);
+        }
+        clock->advance_to(start + 365 * 24 * 60 * minute);
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - real_start).count();
+        std::cout << "year: minutes " << minutes << ", hours " << hours << ", days " << days
+            << ", " << seconds << " s" << std::endl;
+        if (minutes != 365 * 24 * 60 || hours != 365 * 24 || days != 365 || !is_order) is_ok = false;
+
+        // removal of a timer of a service without a thread does not block
+        service_a.remove(id);
+        clock->advance(2 * 24 * 60 * minute);
+        if (days != 365 || service_a.size() != 1) is_ok = false;
+    }
+
+    // reset and one-shot timers follow the virtual time
+    {
+        std::shared_ptr<ztime::VirtualClock> clock = std::make_shared<ztime::VirtualClock>(start);
+        ztime::TimerService service(clock);
+        uint64_t fired = 0;
+        const uint64_t id = service.add([&]()->uint64_t {
+            fired = clock->get_time_ns();
+            return 0;
+        }, 10 * second, ztime::FIXED_DELAY);
+        clock->advance(9 * second);
+        service.reset(id);
+        clock->advance(9 * second);
+        if (fired) is_ok = false;
+        clock->advance(9 * second);
+        std::cout << "one-shot: " << (fired - start) / second << " s" << std::endl;
+        if (fired != start + 19 * second || service.size() != 0) is_ok = false;
+    }
+
+    // functions of the current time use the installed clock
+    {
+        ztime::VirtualClock clock(start + 1500 * second / 1000);
+        ztime::set_clock(&clock);
+        const ztime::timestamp_t t = ztime::get_timestamp();
+        const uint32_t ms = ztime::get_millisecond();
+        ztime::set_clock(nullptr);
+        std::cout << "timestamp: " << t << " " << ms << std::endl;
+        if (t != 1704067201ULL || ms != 500) is_ok = false;
+        if (ztime::get_timestamp() < 1704067201ULL + 3600) is_ok = false;
+    }
+
+    if (is_ok) std::cout << "ok" << std::endl;
+    else std::cout << "error" << std::endl;
+    return 0;
+}
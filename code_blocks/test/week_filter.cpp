@@ -0,0 +1,52 @@
+#include <iostream>
+#include <vector>
+#include <ztime_week_filter.hpp>
+
+int main() {
+    ztime::WeekFilter filter;
+    if (!filter.add("MON-FRI 09:30-16:00, SUN 22:00-24:00")) {
+        std::cout << "parse error" << std::endl;
+        return 0;
+    }
+
+    // ticks every 7 seconds over 4 weeks
+    std::vector<uint64_t> ticks;
+    const ztime::timestamp_t start = ztime::get_timestamp(1, 1, 2024);
+    for (ztime::timestamp_t t = start; t < (start + 4 * ztime::SEC_PER_WEEK); t += 7) {
+        ticks.push_back(t);
+    }
+
+    // reference check with the calendar functions
+    size_t expected = 0;
+    for (size_t i = 0; i < ticks.size(); ++i) {
+        const uint32_t wday = ztime::get_weekday(ticks[i]);
+        const uint32_t second = ztime::get_second_day(ticks[i]);
+        if (wday >= ztime::MON && wday <= ztime::FRI &&
+            second >= ztime::get_second_day(9, 30, 0) &&
+            second < ztime::get_second_day(16, 0, 0)) ++expected;
+        else if (wday == ztime::SUN && second >= ztime::get_second_day(22, 0, 0)) ++expected;
+    }
+
+    ztime::Timer timer;
+    const size_t counted = filter.count(ticks.data(), ticks.size());
+    std::cout << "count:         " << counted << " " << timer.elapsed() << " s" << std::endl;
+
+    std::vector<uint64_t> out(ticks.size());
+    timer.reset();
+    const size_t filtered = filter.filter_sorted(ticks.data(), ticks.size(), out.data());
+    std::cout << "filter_sorted: " << filtered << " " << timer.elapsed() << " s" << std::endl;
+
+    std::vector<ztime::period_t> runs;
+    filter.find_runs(ticks.data(), ticks.size(), runs);
+    std::cout << "runs:          " << runs.size() << std::endl;
+
+    std::cout << "check " << ztime::get_str_date_time(ztime::get_timestamp(2, 1, 2024, 10, 0, 0)) << ": "
+        << filter.check(ztime::get_timestamp(2, 1, 2024, 10, 0, 0)) << std::endl;
+
+    if (counted == expected && filtered == expected && runs.size() == 4 * 6) {
+        std::cout << "ok" << std::endl;
+    } else {
+        std::cout << "error, expected " << expected << std::endl;
+    }
+    return 0;
+}
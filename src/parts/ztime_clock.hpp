@@ -0,0 +1,146 @@
+/*
+* ztime_cpp - Library for work with time.
+*
+* Copyright (c) 2018 Elektro Yar. Email: git.electroyar@gmail.com
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#pragma once
+#ifndef ZTIME_CLOCK_HPP_INCLUDED
+#define ZTIME_CLOCK_HPP_INCLUDED
+
+#include <cstdint>
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+#include <limits>
+
+namespace ztime {
+
+    /** \brief Source of the current time
+     * A clock set by ztime::set_clock() replaces the system clock
+     * for get_timestamp(), get_ftimestamp() and other functions of the current time.
+     */
+    class ClockSource {
+    public:
+
+        virtual ~ClockSource() {};
+
+        /** \brief Get the time
+         * \return Time since the Unix epoch, ns
+         */
+        virtual uint64_t get_time_ns() const noexcept = 0;
+    };
+
+    /** \brief Virtual clock for simulations and replays of data
+     *
+     * The time moves only by advance() and advance_to(). Timer services
+     * created with the clock have no thread: advance_to() runs their callbacks
+     * in the calling thread in the order of deadlines, and the clock shows
+     * the deadline of the running callback. Nothing sleeps, so a year
+     * of events is replayed as fast as the callbacks run.
+     */
+    class VirtualClock : public ClockSource {
+    public:
+
+        static const uint64_t NO_DEADLINE = std::numeric_limits<uint64_t>::max();
+
+        /** \brief Timers driven by the clock
+         */
+        class Listener {
+        public:
+
+            virtual ~Listener() {};
+
+            /** \brief Get the nearest deadline, NO_DEADLINE if there are no timers
+             */
+            virtual uint64_t get_next_deadline() = 0;
+
+            /** \brief Run the callbacks whose deadline is not later than the time
+             * \param t Current time of the clock, ns
+             */
+            virtual void run_until(const uint64_t t) = 0;
+        };
+
+        /** \brief Constructor of the clock
+         * \param time_ns Initial time since the Unix epoch, ns
+         */
+        explicit VirtualClock(const uint64_t time_ns = 0) noexcept : m_time(time_ns) {};
+
+        VirtualClock(const VirtualClock &) = delete;
+        VirtualClock &operator=(const VirtualClock &) = delete;
+
+        uint64_t get_time_ns() const noexcept override {
+            return m_time.load(std::memory_order_acquire);
+        }
+
+        /** \brief Move the time forward and run the timers on the way
+         * The time never goes back, an earlier time is ignored.
+         * May be called from a callback, then the nested call runs the timers.
+         * \param t Time since the Unix epoch, ns
+         */
+        void advance_to(const uint64_t t) {
+            std::lock_guard<std::recursive_mutex> lock(m_mutex);
+            if (t < get_time_ns()) return;
+            while (true) {
+                // the listener with the nearest deadline runs first, so the order is kept between services
+                Listener *next = nullptr;
+                uint64_t deadline = NO_DEADLINE;
+                for (size_t i = 0; i < m_listeners.size(); ++i) {
+                    const uint64_t value = m_listeners[i]->get_next_deadline();
+                    if (value < deadline) {
+                        deadline = value;
+                        next = m_listeners[i];
+                    }
+                }
+                if (!next || deadline > t) break;
+                if (deadline > get_time_ns()) m_time.store(deadline, std::memory_order_release);
+                next->run_until(get_time_ns());
+            }
+            m_time.store(t, std::memory_order_release);
+        }
+
+        /** \brief Move the time forward by the duration
+         * \param duration_ns Duration, ns
+         */
+        inline void advance(const uint64_t duration_ns) {
+            std::lock_guard<std::recursive_mutex> lock(m_mutex);
+            advance_to(get_time_ns() + duration_ns);
+        }
+
+        void subscribe(Listener *listener) {
+            std::lock_guard<std::recursive_mutex> lock(m_mutex);
+            m_listeners.push_back(listener);
+        }
+
+        void unsubscribe(Listener *listener) {
+            std::lock_guard<std::recursive_mutex> lock(m_mutex);
+            m_listeners.erase(std::remove(m_listeners.begin(), m_listeners.end(), listener), m_listeners.end());
+        }
+
+    private:
+        std::atomic<uint64_t>       m_time;
+        std::recursive_mutex        m_mutex;
+        std::vector<Listener*>      m_listeners;
+    };
+
+}; // ztime
+
+#endif // ZTIME_CLOCK_HPP_INCLUDED
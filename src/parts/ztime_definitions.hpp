@@ -55,6 +55,7 @@ namespace ztime {
         SEC_PER_HALF_HOUR = 1800,
         SEC_PER_HOUR = 3600,
         SEC_PER_DAY = 86400,
+        SEC_PER_WEEK = 604800,
         SEC_PER_YEAR = 31536000,
         SEC_PER_LEAP_YEAR = 31622400,
         AVG_SEC_PER_YEAR = 31557600,
@@ -99,6 +100,14 @@ namespace ztime {
         DEC         ///< December
     };
 
+    /// Time zones supported by the conversion functions (Часовые пояса)
+    enum TimeZone {
+        GMT = 0,    ///< Greenwich Mean Time
+        CET,        ///< Central European Time (with summer time)
+        EET,        ///< Eastern European Time (with summer time)
+        MSK         ///< Moscow Time
+    };
+
     const char* const MonthNameLong[] = {
         "January", "February", "March",
         "April", "May", "June",
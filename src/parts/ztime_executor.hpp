@@ -0,0 +1,346 @@
+/*
+* ztime_cpp - Library for work with time.
+*
+* Copyright (c) 2018 Elektro Yar. Email: git.electroyar@gmail.com
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#pragma once
+#ifndef ZTIME_EXECUTOR_HPP_INCLUDED
+#define ZTIME_EXECUTOR_HPP_INCLUDED
+
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include "ztime_inplace_function.hpp"
+#include "ztime_thread_config.hpp"
+
+namespace ztime {
+
+    /** \brief Interface of an executor of timer callbacks
+     */
+    class Executor {
+    public:
+        static const size_t TASK_SIZE = 32;                         /**< Size of the buffer of the task */
+        typedef InplaceFunction<void(), TASK_SIZE> task_t;          /**< Task, stored without heap allocations */
+
+        virtual ~Executor() {};
+
+        /** \brief Execute a task
+         * \param task Task
+         */
+        virtual void execute(task_t task) = 0;
+
+        /** \brief Check that tasks are executed in the calling thread
+         */
+        virtual bool is_inline() const noexcept {
+            return false;
+        }
+
+        /** \brief Apply the configuration to the threads of the executor
+         * \param config Configuration
+         * \return Returns true if all settings were applied, an executor without threads has nothing to apply
+         */
+        virtual bool set_thread_config(const ThreadConfig &config) {
+            (void)config;
+            return true;
+        }
+    };
+
+    /** \brief Queue of tasks in a ring buffer with both ends open
+     * The buffer grows twice when it is full and is never shrunk,
+     * so the queue of a warmed-up executor does not allocate
+     */
+    class TaskQueue {
+    public:
+        typedef Executor::task_t task_t;
+
+        inline bool empty() const noexcept {
+            return !m_size;
+        }
+
+        inline size_t size() const noexcept {
+            return m_size;
+        }
+
+        void push_back(task_t &&task) {
+            if (m_size == m_tasks.size()) grow();
+            m_tasks[(m_head + m_size) & (m_tasks.size() - 1)] = std::move(task);
+            ++m_size;
+        }
+
+        /** \brief Take the oldest task, the queue must not be empty
+         */
+        inline task_t pop_front() noexcept {
+            task_t task(std::move(m_tasks[m_head]));
+            m_head = (m_head + 1) & (m_tasks.size() - 1);
+            --m_size;
+            return task;
+        }
+
+        /** \brief Take the newest task, the queue must not be empty
+         */
+        inline task_t pop_back() noexcept {
+            --m_size;
+            return task_t(std::move(m_tasks[(m_head + m_size) & (m_tasks.size() - 1)]));
+        }
+
+    private:
+        std::vector<task_t> m_tasks;    /**< Ring buffer, the size is a power of two */
+        size_t              m_head = 0;
+        size_t              m_size = 0;
+
+        void grow() {
+            std::vector<task_t> tasks(m_tasks.empty() ? 16 : m_tasks.size() * 2);
+            for (size_t i = 0; i < m_size; ++i) {
+                tasks[i] = std::move(m_tasks[(m_head + i) & (m_tasks.size() - 1)]);
+            }
+            m_tasks.swap(tasks);
+            m_head = 0;
+        }
+    };
+
+    /** \brief Executor which runs tasks in the calling thread
+     */
+    class InlineExecutor final : public Executor {
+    public:
+
+        void execute(task_t task) override {
+            task();
+        }
+
+        bool is_inline() const noexcept override {
+            return true;
+        }
+    };
+
+    /** \brief Fixed pool of threads with a common queue of tasks
+     */
+    class ThreadPoolExecutor final : public Executor {
+    public:
+
+        /** \brief Constructor of the pool
+         * \param num_threads Number of threads, 0 - number of hardware threads
+         */
+        ThreadPoolExecutor(size_t num_threads = 0) {
+            if (!num_threads) num_threads = std::max(1u, std::thread::hardware_concurrency());
+            for (size_t i = 0; i < num_threads; ++i) {
+                m_threads.emplace_back([this] {
+                    work();
+                });
+            }
+        }
+
+        ~ThreadPoolExecutor() {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_shutdown = true;
+            }
+            m_cv.notify_all();
+            for (size_t i = 0; i < m_threads.size(); ++i) {
+                if (m_threads[i].get_id() == std::this_thread::get_id()) m_threads[i].detach();
+                else m_threads[i].join();
+            }
+        }
+
+        void execute(task_t task) override {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_tasks.push_back(std::move(task));
+            }
+            m_cv.notify_one();
+        }
+
+        inline size_t size() const noexcept {
+            return m_threads.size();
+        }
+
+        bool set_thread_config(const ThreadConfig &config) override {
+            bool is_ok = true;
+            for (size_t i = 0; i < m_threads.size(); ++i) {
+                if (!apply_thread_config(m_threads[i].native_handle(), config)) is_ok = false;
+            }
+            return is_ok;
+        }
+
+    private:
+        std::vector<std::thread>    m_threads;
+        TaskQueue                   m_tasks;
+        std::mutex                  m_mutex;
+        std::condition_variable     m_cv;
+        bool                        m_shutdown = false;
+
+        void work() {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            while (true) {
+                m_cv.wait(lock, [this] {
+                    return m_shutdown || !m_tasks.empty();
+                });
+                if (m_tasks.empty()) return;
+                task_t task = m_tasks.pop_front();
+                lock.unlock();
+                task();
+                lock.lock();
+            }
+        }
+    };
+
+    /** \brief Pool of threads with a queue per thread and work stealing
+     *
+     * Tasks from outside of the pool are distributed round-robin, tasks submitted
+     * by a thread of the pool go to its own queue. A thread takes tasks from the
+     * back of its own queue and steals from the front of the other queues.
+     */
+    class WorkStealingExecutor final : public Executor {
+    public:
+
+        /** \brief Constructor of the pool
+         * \param num_threads Number of threads, 0 - number of hardware threads
+         */
+        WorkStealingExecutor(size_t num_threads = 0) {
+            if (!num_threads) num_threads = std::max(1u, std::thread::hardware_concurrency());
+            for (size_t i = 0; i < num_threads; ++i) {
+                m_queues.emplace_back(new Queue());
+            }
+            for (size_t i = 0; i < num_threads; ++i) {
+                m_threads.emplace_back([this, i] {
+                    work(i);
+                });
+            }
+        }
+
+        ~WorkStealingExecutor() {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_shutdown = true;
+            }
+            m_cv.notify_all();
+            for (size_t i = 0; i < m_threads.size(); ++i) {
+                if (m_threads[i].get_id() == std::this_thread::get_id()) m_threads[i].detach();
+                else m_threads[i].join();
+            }
+        }
+
+        void execute(task_t task) override {
+            const size_t index = get_worker_index() < m_queues.size() ?
+                get_worker_index() : (m_next++ % m_queues.size());
+            {
+                std::lock_guard<std::mutex> lock(m_queues[index]->mutex);
+                m_queues[index]->tasks.push_back(std::move(task));
+            }
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                ++m_pending;
+            }
+            m_cv.notify_one();
+        }
+
+        inline size_t size() const noexcept {
+            return m_threads.size();
+        }
+
+        bool set_thread_config(const ThreadConfig &config) override {
+            bool is_ok = true;
+            for (size_t i = 0; i < m_threads.size(); ++i) {
+                if (!apply_thread_config(m_threads[i].native_handle(), config)) is_ok = false;
+            }
+            return is_ok;
+        }
+
+    private:
+
+        struct Queue {
+            std::mutex          mutex;
+            TaskQueue           tasks;
+        };
+
+        std::vector<std::unique_ptr<Queue>> m_queues;
+        std::vector<std::thread>            m_threads;
+        std::mutex                          m_mutex;
+        std::condition_variable             m_cv;
+        std::atomic<size_t>                 m_next = ATOMIC_VAR_INIT(0);
+        size_t                              m_pending = 0;
+        bool                                m_shutdown = false;
+
+        /** \brief Index of the current thread in the pool
+         */
+        inline size_t get_worker_index() const noexcept {
+            return get_owner() == this ? get_index() : (size_t)-1;
+        }
+
+        static inline const WorkStealingExecutor *&get_owner() noexcept {
+            static thread_local const WorkStealingExecutor *owner = nullptr;
+            return owner;
+        }
+
+        static inline size_t &get_index() noexcept {
+            static thread_local size_t index = 0;
+            return index;
+        }
+
+        bool take(const size_t index, task_t &task) {
+            {
+                Queue &own = *m_queues[index];
+                std::lock_guard<std::mutex> lock(own.mutex);
+                if (!own.tasks.empty()) {
+                    task = own.tasks.pop_back();
+                    return true;
+                }
+            }
+            for (size_t i = 1; i < m_queues.size(); ++i) {
+                Queue &other = *m_queues[(index + i) % m_queues.size()];
+                std::lock_guard<std::mutex> lock(other.mutex);
+                if (!other.tasks.empty()) {
+                    task = other.tasks.pop_front();
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void work(const size_t index) {
+            get_owner() = this;
+            get_index() = index;
+            while (true) {
+                {
+                    std::unique_lock<std::mutex> lock(m_mutex);
+                    m_cv.wait(lock, [this] {
+                        return m_shutdown || m_pending > 0;
+                    });
+                    if (!m_pending) return;
+                    --m_pending;
+                }
+                // the task counted above is in one of the queues
+                task_t task;
+                while (!take(index, task)) {
+                    std::this_thread::yield();
+                }
+                task();
+            }
+        }
+    };
+
+}; // ztime
+
+#endif // ZTIME_EXECUTOR_HPP_INCLUDED
@@ -0,0 +1,132 @@
+/*
+* ztime_cpp - Library for work with time.
+*
+* Copyright (c) 2018 Elektro Yar. Email: git.electroyar@gmail.com
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#pragma once
+#ifndef ZTIME_HISTOGRAM_HPP_INCLUDED
+#define ZTIME_HISTOGRAM_HPP_INCLUDED
+
+#include <cstdint>
+#include <atomic>
+#include <array>
+
+namespace ztime {
+
+    /** \brief Snapshot of a histogram
+     * Bucket 0 counts the value 0, bucket i counts the values [2^(i-1), 2^i)
+     */
+    struct HistogramSnapshot {
+        static const size_t BUCKETS = 65;
+
+        std::array<uint64_t, BUCKETS> counts;   /**< Number of values in the buckets */
+        uint64_t count = 0;                     /**< Number of values */
+        uint64_t sum = 0;                       /**< Sum of values */
+        uint64_t max = 0;                       /**< Maximum value */
+
+        HistogramSnapshot() {
+            counts.fill(0);
+        }
+
+        inline double get_mean() const noexcept {
+            return count ? (double)sum / (double)count : 0.0;
+        }
+
+        /** \brief Get the upper bound of the percentile
+         * \param p Percentile, 0.0 ... 1.0
+         * \return Upper bound of the bucket of the percentile, not more than max
+         */
+        uint64_t get_percentile(const double p) const noexcept {
+            if (!count) return 0;
+            uint64_t rank = (uint64_t)(p * (double)count);
+            if (rank >= count) rank = count - 1;
+            uint64_t total = 0;
+            for (size_t i = 0; i < BUCKETS; ++i) {
+                total += counts[i];
+                if (total > rank) {
+                    const uint64_t bound = get_upper_bound(i);
+                    return bound < max ? bound : max;
+                }
+            }
+            return max;
+        }
+
+        /** \brief Get the largest value of the bucket
+         */
+        static inline uint64_t get_upper_bound(const size_t bucket) noexcept {
+            if (!bucket) return 0;
+            if (bucket >= 64) return UINT64_MAX;
+            return (1ULL << bucket) - 1;
+        }
+    };
+
+    /** \brief Lock-free histogram with log2 buckets
+     * A value is recorded by relaxed atomic increments, the histogram can be
+     * written by several threads and read at any time.
+     */
+    class Histogram {
+    public:
+
+        Histogram() {
+            for (size_t i = 0; i < HistogramSnapshot::BUCKETS; ++i) {
+                m_counts[i].store(0, std::memory_order_relaxed);
+            }
+        }
+
+        Histogram(const Histogram &) = delete;
+        Histogram &operator=(const Histogram &) = delete;
+
+        inline void record(const uint64_t value) noexcept {
+            m_counts[get_bucket(value)].fetch_add(1, std::memory_order_relaxed);
+            m_count.fetch_add(1, std::memory_order_relaxed);
+            m_sum.fetch_add(value, std::memory_order_relaxed);
+            uint64_t max = m_max.load(std::memory_order_relaxed);
+            while (value > max && !m_max.compare_exchange_weak(max, value, std::memory_order_relaxed)) {};
+        }
+
+        /** \brief Get the snapshot
+         * Values recorded during the call may be counted partially
+         */
+        HistogramSnapshot get_snapshot() const noexcept {
+            HistogramSnapshot snapshot;
+            for (size_t i = 0; i < HistogramSnapshot::BUCKETS; ++i) {
+                snapshot.counts[i] = m_counts[i].load(std::memory_order_relaxed);
+            }
+            snapshot.count = m_count.load(std::memory_order_relaxed);
+            snapshot.sum = m_sum.load(std::memory_order_relaxed);
+            snapshot.max = m_max.load(std::memory_order_relaxed);
+            return snapshot;
+        }
+
+        static inline size_t get_bucket(const uint64_t value) noexcept {
+            return value ? 64 - __builtin_clzll(value) : 0;
+        }
+
+    private:
+        std::array<std::atomic<uint64_t>, HistogramSnapshot::BUCKETS> m_counts;
+        std::atomic<uint64_t> m_count = ATOMIC_VAR_INIT(0);
+        std::atomic<uint64_t> m_sum = ATOMIC_VAR_INIT(0);
+        std::atomic<uint64_t> m_max = ATOMIC_VAR_INIT(0);
+    };
+
+}; // ztime
+
+#endif // ZTIME_HISTOGRAM_HPP_INCLUDED
@@ -0,0 +1,164 @@
+/*
+* ztime_cpp - Library for work with time.
+*
+* Copyright (c) 2018 Elektro Yar. Email: git.electroyar@gmail.com
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#pragma once
+#ifndef ZTIME_INPLACE_FUNCTION_HPP_INCLUDED
+#define ZTIME_INPLACE_FUNCTION_HPP_INCLUDED
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <type_traits>
+#include <functional>
+
+namespace ztime {
+
+    template<class Signature, size_t Capacity = 64>
+    class InplaceFunction;
+
+    /** \brief Move-only callable with a fixed inplace buffer
+     *
+     * The callable is stored inside the object and is never allocated on the heap.
+     * A callable larger than Capacity does not compile. Move-only callables
+     * (lambdas which own a std::unique_ptr) are accepted. A moved-from function is empty.
+     * \tparam R        Result
+     * \tparam Args     Arguments
+     * \tparam Capacity Size of the buffer, bytes
+     */
+    template<class R, class... Args, size_t Capacity>
+    class InplaceFunction<R(Args...), Capacity> {
+    public:
+        static const size_t CAPACITY = Capacity;
+
+        InplaceFunction() noexcept {};
+
+        InplaceFunction(std::nullptr_t) noexcept {};
+
+        template<class F, class D = typename std::decay<F>::type,
+            class = typename std::enable_if<!std::is_same<D, InplaceFunction>::value>::type>
+        InplaceFunction(F &&f) {
+            static_assert(sizeof(D) <= Capacity, "ztime::InplaceFunction: the callable is larger than the capacity");
+            static_assert(alignof(D) <= alignof(Storage), "ztime::InplaceFunction: the alignment of the callable is too large");
+            if (is_null(f)) return;
+            new (&m_storage) D(std::forward<F>(f));
+            m_vtable = &get_vtable<D>();
+        }
+
+        InplaceFunction(InplaceFunction &&other) noexcept {
+            move_from(other);
+        }
+
+        InplaceFunction &operator=(InplaceFunction &&other) noexcept {
+            if (this == &other) return *this;
+            reset();
+            move_from(other);
+            return *this;
+        }
+
+        InplaceFunction &operator=(std::nullptr_t) noexcept {
+            reset();
+            return *this;
+        }
+
+        InplaceFunction(const InplaceFunction &) = delete;
+        InplaceFunction &operator=(const InplaceFunction &) = delete;
+
+        ~InplaceFunction() {
+            reset();
+        }
+
+        inline R operator()(Args... args) const {
+            if (!m_vtable) throw std::bad_function_call();
+            return m_vtable->invoke(const_cast<Storage*>(&m_storage), std::forward<Args>(args)...);
+        }
+
+        explicit operator bool() const noexcept {
+            return m_vtable != nullptr;
+        }
+
+    private:
+        typedef typename std::aligned_storage<Capacity, alignof(std::max_align_t)>::type Storage;
+
+        struct VTable {
+            R (*invoke)(void *, Args&&...);
+            void (*move)(void *, void *) noexcept;
+            void (*destroy)(void *) noexcept;
+        };
+
+        Storage         m_storage;
+        const VTable    *m_vtable = nullptr;
+
+        template<class D>
+        static R invoke(void *storage, Args&&... args) {
+            return (*static_cast<D*>(storage))(std::forward<Args>(args)...);
+        }
+
+        template<class D>
+        static void move(void *dst, void *src) noexcept {
+            new (dst) D(std::move(*static_cast<D*>(src)));
+            static_cast<D*>(src)->~D();
+        }
+
+        template<class D>
+        static void destroy(void *storage) noexcept {
+            static_cast<D*>(storage)->~D();
+        }
+
+        template<class D>
+        static const VTable &get_vtable() noexcept {
+            static const VTable vtable = {&invoke<D>, &move<D>, &destroy<D>};
+            return vtable;
+        }
+
+        inline void move_from(InplaceFunction &other) noexcept {
+            if (!other.m_vtable) return;
+            other.m_vtable->move(&m_storage, &other.m_storage);
+            m_vtable = other.m_vtable;
+            other.m_vtable = nullptr;
+        }
+
+        inline void reset() noexcept {
+            if (!m_vtable) return;
+            m_vtable->destroy(&m_storage);
+            m_vtable = nullptr;
+        }
+
+        template<class T>
+        static inline bool is_null(const T &) noexcept {
+            return false;
+        }
+
+        template<class T>
+        static inline bool is_null(T *f) noexcept {
+            return f == nullptr;
+        }
+
+        template<class S>
+        static inline bool is_null(const std::function<S> &f) noexcept {
+            return !f;
+        }
+    };
+
+}; // ztime
+
+#endif // ZTIME_INPLACE_FUNCTION_HPP_INCLUDED
@@ -0,0 +1,189 @@
+/*
+* ztime_cpp - Library for work with time.
+*
+* Copyright (c) 2018 Elektro Yar. Email: git.electroyar@gmail.com
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#pragma once
+#ifndef ZTIME_SLOT_MAP_HPP_INCLUDED
+#define ZTIME_SLOT_MAP_HPP_INCLUDED
+
+#include <cstdint>
+#include <vector>
+#include <utility>
+
+namespace ztime {
+
+    /** \brief Generational handles of slots
+     * The handle keeps the index of the slot in the low 32 bits and the generation
+     * of the slot in the high 32 bits. The generation of a slot is incremented
+     * when the slot is freed, so an old handle never matches a reused slot.
+     * Generations start from 1, the handle 0 is never valid.
+     */
+    struct SlotHandle {
+        static const uint64_t INVALID = 0;
+
+        static inline uint64_t make(const uint32_t index, const uint32_t generation) noexcept {
+            return ((uint64_t)generation << 32) | index;
+        }
+
+        static inline uint32_t get_index(const uint64_t handle) noexcept {
+            return (uint32_t)(handle & 0xFFFFFFFF);
+        }
+
+        static inline uint32_t get_generation(const uint64_t handle) noexcept {
+            return (uint32_t)(handle >> 32);
+        }
+
+        /** \brief Get the next generation of a slot, 0 is skipped
+         */
+        static inline uint32_t get_next_generation(const uint32_t generation) noexcept {
+            return generation == 0xFFFFFFFF ? 1 : generation + 1;
+        }
+    };
+
+    /** \brief Generational slot map
+     *
+     * Values are stored in a vector of slots, freed slots are reused through
+     * a free list, so insert, erase and lookup are O(1) and the memory does not
+     * grow beyond the largest number of values stored at once. Handles of
+     * erased values are detected as stale.
+     */
+    template<class T>
+    class SlotMap {
+    public:
+        typedef uint64_t handle_t;
+
+        /** \brief Insert a value
+         * \return Handle of the value
+         */
+        handle_t insert(T value) {
+            uint32_t index = 0;
+            if (!m_free.empty()) {
+                index = m_free.back();
+                m_free.pop_back();
+            } else {
+                index = (uint32_t)m_slots.size();
+                m_slots.push_back(Slot());
+            }
+            Slot &slot = m_slots[index];
+            slot.value = std::move(value);
+            slot.is_used = true;
+            ++m_size;
+            return SlotHandle::make(index, slot.generation);
+        }
+
+        /** \brief Erase the value
+         * \param handle Handle of the value
+         * \return Returns false if the handle is stale
+         */
+        bool erase(const handle_t handle) {
+            Slot *slot = find(handle);
+            if (!slot) return false;
+            slot->value = T();
+            slot->is_used = false;
+            slot->generation = SlotHandle::get_next_generation(slot->generation);
+            m_free.push_back(SlotHandle::get_index(handle));
+            --m_size;
+            return true;
+        }
+
+        /** \brief Get the value
+         * \param handle Handle of the value
+         * \return Pointer to the value or nullptr if the handle is stale
+         */
+        inline T *get(const handle_t handle) noexcept {
+            Slot *slot = find(handle);
+            return slot ? &slot->value : nullptr;
+        }
+
+        inline const T *get(const handle_t handle) const noexcept {
+            return const_cast<SlotMap*>(this)->get(handle);
+        }
+
+        inline bool contains(const handle_t handle) const noexcept {
+            return get(handle) != nullptr;
+        }
+
+        /** \brief Reserve the storage for several values
+         * \param count Number of values which will be inserted
+         */
+        void reserve(const size_t count) {
+            if (count <= m_free.size()) return;
+            m_slots.reserve(m_slots.size() + count - m_free.size());
+        }
+
+        /** \brief Call a function for every value
+         * \param f Function f(handle, value)
+         */
+        template<class F>
+        void for_each(F f) {
+            for (size_t i = 0; i < m_slots.size(); ++i) {
+                if (!m_slots[i].is_used) continue;
+                f(SlotHandle::make((uint32_t)i, m_slots[i].generation), m_slots[i].value);
+            }
+        }
+
+        /** \brief Remove all values, handles of the values become stale
+         */
+        void clear() {
+            for (size_t i = 0; i < m_slots.size(); ++i) {
+                if (!m_slots[i].is_used) continue;
+                erase(SlotHandle::make((uint32_t)i, m_slots[i].generation));
+            }
+        }
+
+        inline size_t size() const noexcept {
+            return m_size;
+        }
+
+        inline bool empty() const noexcept {
+            return m_size == 0;
+        }
+
+        /** \brief Get the number of slots, used and free
+         */
+        inline size_t capacity() const noexcept {
+            return m_slots.size();
+        }
+
+    private:
+        struct Slot {
+            T           value = T();
+            uint32_t    generation = 1;
+            bool        is_used = false;
+        };
+
+        std::vector<Slot>       m_slots;
+        std::vector<uint32_t>   m_free;
+        size_t                  m_size = 0;
+
+        inline Slot *find(const handle_t handle) noexcept {
+            const uint32_t index = SlotHandle::get_index(handle);
+            if (index >= m_slots.size()) return nullptr;
+            Slot &slot = m_slots[index];
+            if (!slot.is_used || slot.generation != SlotHandle::get_generation(handle)) return nullptr;
+            return &slot;
+        }
+    };
+
+}; // ztime
+
+#endif // ZTIME_SLOT_MAP_HPP_INCLUDED
@@ -0,0 +1,111 @@
+/*
+* ztime_cpp - Library for work with time.
+*
+* Copyright (c) 2018 Elektro Yar. Email: git.electroyar@gmail.com
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#pragma once
+#ifndef ZTIME_THREAD_CONFIG_HPP_INCLUDED
+#define ZTIME_THREAD_CONFIG_HPP_INCLUDED
+
+#include <string>
+#include <vector>
+#include <thread>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#endif
+
+namespace ztime {
+
+    /// Scheduling policies of threads
+    enum ThreadPolicy {
+        THREAD_SCHED_OTHER = 0,     ///< Time-sharing scheduling of the OS
+        THREAD_SCHED_FIFO,          ///< Real-time FIFO scheduling, the thread is not preempted by SCHED_OTHER threads
+    };
+
+    /** \brief Configuration of a thread for latency-critical timers
+     */
+    struct ThreadConfig {
+        std::string     name;                       /**< Name of the thread, up to 15 characters on Linux, empty - keep the name */
+        std::vector<int> cpus;                      /**< CPUs of the thread, empty - keep the affinity */
+        ThreadPolicy    policy = THREAD_SCHED_OTHER;
+        int             priority = 0;               /**< Priority of THREAD_SCHED_FIFO, 1 ... 99 */
+        bool            is_lock_memory = false;     /**< Lock the memory of the process (mlockall), it affects all threads */
+    };
+
+    /** \brief Apply the configuration to the thread
+     * Settings which fail are skipped, the rest are applied.
+     * THREAD_SCHED_FIFO and memory locking need CAP_SYS_NICE and CAP_IPC_LOCK
+     * (or the limits RLIMIT_RTPRIO and RLIMIT_MEMLOCK).
+     * \param handle Native handle of the thread
+     * \param config Configuration
+     * \return Returns true if all settings were applied, always false outside of Linux
+     */
+    inline bool apply_thread_config(std::thread::native_handle_type handle, const ThreadConfig &config) {
+#       if defined(__linux__)
+        bool is_ok = true;
+        if (!config.name.empty()) {
+            // the name with the terminating zero is limited to 16 bytes
+            const std::string name = config.name.substr(0, 15);
+            if (pthread_setname_np(handle, name.c_str()) != 0) is_ok = false;
+        }
+        if (!config.cpus.empty()) {
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            for (size_t i = 0; i < config.cpus.size(); ++i) {
+                if (config.cpus[i] >= 0 && config.cpus[i] < CPU_SETSIZE) CPU_SET(config.cpus[i], &cpus);
+            }
+            if (pthread_setaffinity_np(handle, sizeof(cpus), &cpus) != 0) is_ok = false;
+        }
+        struct sched_param param = {};
+        int policy = SCHED_OTHER;
+        if (config.policy == THREAD_SCHED_FIFO) {
+            policy = SCHED_FIFO;
+            param.sched_priority = config.priority;
+        }
+        if (pthread_setschedparam(handle, policy, &param) != 0) is_ok = false;
+        if (config.is_lock_memory && mlockall(MCL_CURRENT | MCL_FUTURE) != 0) is_ok = false;
+        return is_ok;
+#       else
+        (void)handle;
+        (void)config;
+        return false;
+#       endif
+    }
+
+    /** \brief Apply the configuration to the current thread
+     * \param config Configuration
+     * \return Returns true if all settings were applied, always false outside of Linux
+     */
+    inline bool apply_thread_config(const ThreadConfig &config) {
+#       if defined(__linux__)
+        return apply_thread_config(pthread_self(), config);
+#       else
+        (void)config;
+        return false;
+#       endif
+    }
+
+}; // ztime
+
+#endif // ZTIME_THREAD_CONFIG_HPP_INCLUDED
@@ -32,15 +32,161 @@
 #include <future>
 #include <thread>
 #include <functional>
+#include <string>
+#include "ztime_inplace_function.hpp"
 
 namespace ztime {
 
+	class TimerService;	// parts/ztime_timer_service.hpp
+	struct TimerStats;
+	struct ThreadConfig;
+
 	/** \brief Class Timer - A Timer for Various Time Measurements
 	 */
 	class Timer {
 	public:
+		static const size_t CALLBACK_SIZE = 64;						/**< Size of the buffer of the callback */
+		typedef InplaceFunction<void(), CALLBACK_SIZE> callback_t;	/**< Callback of the event, stored without heap allocations */
+
+		/** \brief Period of the timer event in milliseconds
+		 * The value is used like std::atomic<uint32_t>, a new value is applied to the running event
+		 */
+		class Period {
+		public:
+			Period(Timer *timer) : m_timer(timer) {};
+
+			Period(const Period &) = delete;
+			Period &operator=(const Period &) = delete;
+
+			inline uint32_t operator=(const uint32_t value) noexcept {
+				store(value);
+				return value;
+			}
+
+			inline operator uint32_t() const noexcept {
+				return load();
+			}
+
+			inline uint32_t load(const std::memory_order order = std::memory_order_seq_cst) const noexcept {
+				return m_value.load(order);
+			}
+
+			inline void store(const uint32_t value, const std::memory_order order = std::memory_order_seq_cst) noexcept {
+				m_value.store(value, order);
+				m_timer->update_period_ms();
+			}
+
+			inline uint32_t exchange(const uint32_t value, const std::memory_order order = std::memory_order_seq_cst) noexcept {
+				const uint32_t prev = m_value.exchange(value, order);
+				m_timer->update_period_ms();
+				return prev;
+			}
+
+			inline bool compare_exchange_weak(uint32_t &expected, const uint32_t desired,
+					const std::memory_order success, const std::memory_order failure) noexcept {
+				if (!m_value.compare_exchange_weak(expected, desired, success, failure)) return false;
+				m_timer->update_period_ms();
+				return true;
+			}
+
+			inline bool compare_exchange_weak(uint32_t &expected, const uint32_t desired,
+					const std::memory_order order = std::memory_order_seq_cst) noexcept {
+				if (!m_value.compare_exchange_weak(expected, desired, order)) return false;
+				m_timer->update_period_ms();
+				return true;
+			}
+
+			inline bool compare_exchange_strong(uint32_t &expected, const uint32_t desired,
+					const std::memory_order success, const std::memory_order failure) noexcept {
+				if (!m_value.compare_exchange_strong(expected, desired, success, failure)) return false;
+				m_timer->update_period_ms();
+				return true;
+			}
+
+			inline bool compare_exchange_strong(uint32_t &expected, const uint32_t desired,
+					const std::memory_order order = std::memory_order_seq_cst) noexcept {
+				if (!m_value.compare_exchange_strong(expected, desired, order)) return false;
+				m_timer->update_period_ms();
+				return true;
+			}
+
+			inline uint32_t fetch_add(const uint32_t arg, const std::memory_order order = std::memory_order_seq_cst) noexcept {
+				const uint32_t prev = m_value.fetch_add(arg, order);
+				m_timer->update_period_ms();
+				return prev;
+			}
+
+			inline uint32_t fetch_sub(const uint32_t arg, const std::memory_order order = std::memory_order_seq_cst) noexcept {
+				const uint32_t prev = m_value.fetch_sub(arg, order);
+				m_timer->update_period_ms();
+				return prev;
+			}
+
+			inline uint32_t fetch_and(const uint32_t arg, const std::memory_order order = std::memory_order_seq_cst) noexcept {
+				const uint32_t prev = m_value.fetch_and(arg, order);
+				m_timer->update_period_ms();
+				return prev;
+			}
+
+			inline uint32_t fetch_or(const uint32_t arg, const std::memory_order order = std::memory_order_seq_cst) noexcept {
+				const uint32_t prev = m_value.fetch_or(arg, order);
+				m_timer->update_period_ms();
+				return prev;
+			}
+
+			inline uint32_t fetch_xor(const uint32_t arg, const std::memory_order order = std::memory_order_seq_cst) noexcept {
+				const uint32_t prev = m_value.fetch_xor(arg, order);
+				m_timer->update_period_ms();
+				return prev;
+			}
+
+			inline uint32_t operator++() noexcept {
+				return fetch_add(1) + 1;
+			}
+
+			inline uint32_t operator++(int) noexcept {
+				return fetch_add(1);
+			}
+
+			inline uint32_t operator--() noexcept {
+				return fetch_sub(1) - 1;
+			}
+
+			inline uint32_t operator--(int) noexcept {
+				return fetch_sub(1);
+			}
+
+			inline uint32_t operator+=(const uint32_t arg) noexcept {
+				return fetch_add(arg) + arg;
+			}
+
+			inline uint32_t operator-=(const uint32_t arg) noexcept {
+				return fetch_sub(arg) - arg;
+			}
 
-		std::atomic<uint32_t> period_ms = ATOMIC_VAR_INIT(0);
+			inline uint32_t operator&=(const uint32_t arg) noexcept {
+				return fetch_and(arg) & arg;
+			}
+
+			inline uint32_t operator|=(const uint32_t arg) noexcept {
+				return fetch_or(arg) | arg;
+			}
+
+			inline uint32_t operator^=(const uint32_t arg) noexcept {
+				return fetch_xor(arg) ^ arg;
+			}
+
+			inline bool is_lock_free() const noexcept {
+				return m_value.is_lock_free();
+			}
+
+		private:
+			friend class Timer;
+			std::atomic<uint32_t>	m_value = ATOMIC_VAR_INIT(0);
+			Timer					*m_timer;
+		};
+
+		Period period_ms{this};
 
 		enum class TimerMode {
 			STRICT_INTERVAL,			/**< First timer mode, where the timer calls the callback at fixed intervals by resetting its internal counter before the callback is called. */
@@ -51,78 +197,65 @@ namespace ztime {
 		Timer() :  m_start_time(clock_t::now()) {};
 
 
+		template<class F>
 		Timer(	const uint32_t interval_ms,
 				const TimerMode mode,
-				const std::function<void()> &callback) : Timer() {
-			create_event(interval_ms, mode, callback);
+				F &&callback) : Timer() {
+			create_event(interval_ms, mode, std::forward<F>(callback));
 		}
 
 		/** \brief Non-blocking async timer constructor
 		 * \param callback Your callback function that will be called asynchronously with a period of period_ms
 		 */
-		Timer(const std::function<void()> &callback) :
-			Timer(0, TimerMode::UNSTABLE_INTERVAL, callback) {
+		template<class F, class = typename std::enable_if<!std::is_same<typename std::decay<F>::type, Timer>::value>::type>
+		Timer(F &&callback) :
+			Timer(0, TimerMode::UNSTABLE_INTERVAL, std::forward<F>(callback)) {
 		}
 
 		~Timer() {
 			stop_event();
 		}
 
+		/** \brief Create the timer event
+		 * Events of all timers are served by the shared timer service (TimerService::get_shared()),
+		 * the timer does not create its own thread
+		 * \param interval_ms	Period of the event in milliseconds, 0 - the event waits for period_ms
+		 * \param mode			Mode of the timer
+		 * \param callback		Callback function, may be move-only, is stored without heap allocations
+		 * \param slack_ms		Allowed delay of the event in milliseconds, lets the service serve several timers in one wake-up
+		 * \return Returns false if the event has already been created
+		 */
+		template<class F>
 		bool create_event(
 				const uint32_t interval_ms,
 				const TimerMode mode,
-				const std::function<void()> &callback) {
-			std::unique_lock<std::mutex> lock(m_event_mtx);
-			if (m_event_init) return false;
-			if (!callback) return false;
-			m_event_init = true;
-			lock.unlock();
-
-			period_ms = interval_ms;
-			m_mode = mode;
-			m_callback = callback;
-
-			m_timer_future = std::async(std::launch::async, [this]() {
-
-				using ms_t = std::chrono::duration<uint32_t, std::ratio<1, 1000>>;
-				using ms64_t = std::chrono::duration<uint64_t, std::ratio<1, 1000>>;
-
-				if (m_mode == TimerMode::ONE_SHOT_AFTER_INTERVAL) {
-					m_event_start_time = clock_t::now();
-				}
-				std::chrono::time_point<clock_t> start_time = clock_t::now();
-
-				while (!false) {
-					std::this_thread::sleep_for(std::chrono::milliseconds(1));
-
-					if (m_shutdown) return;
-					if (!period_ms) continue;
-
-					if (m_mode == TimerMode::ONE_SHOT_AFTER_INTERVAL) {
-						std::unique_lock<std::mutex> lock(m_event_time);
-						const uint64_t elapsed = get_elapsed<uint64_t, ms64_t>(m_event_start_time);
-						if (elapsed < period_ms) continue;
-						if (m_once_event) continue;
-						m_once_event = true;
-						lock.unlock();
-						m_callback();
-						continue;
-					}
-
-					const uint32_t elapsed = get_elapsed<uint32_t, ms_t>(start_time);
-
-					if (elapsed >= period_ms) {
-						if (m_mode == TimerMode::STRICT_INTERVAL) {
-							start_time = clock_t::now();
-						}
-						m_callback();
-						if (m_mode == TimerMode::UNSTABLE_INTERVAL) {
-							start_time = clock_t::now();
-						}
-					}
-				}
-			});
-			return true;
+				F &&callback,
+				const uint32_t slack_ms = 0) {
+			return create_event(
+				std::chrono::milliseconds(interval_ms), mode, std::forward<F>(callback),
+				std::chrono::nanoseconds(0), std::chrono::milliseconds(slack_ms));
+		}
+
+		/** \brief Create the timer event with a period of nanosecond resolution
+		 * The busy-spin tail makes the thread of the service wake up before the deadline
+		 * and spin until it. This lowers the jitter to microseconds at the cost of CPU time
+		 * \param interval	Period of the event, 0 - the event waits for period_ms or set_period()
+		 * \param mode		Mode of the timer
+		 * \param callback	Callback function
+		 * \param spin		Busy-spin tail before the deadline, 0 - no spinning
+		 * \param slack		Allowed delay of the event, lets the service serve several timers in one wake-up
+		 * \return Returns false if the event has already been created
+		 */
+		template<class F>
+		bool create_event(
+				const std::chrono::nanoseconds interval,
+				const TimerMode mode,
+				F &&callback,
+				const std::chrono::nanoseconds spin = std::chrono::nanoseconds(0),
+				const std::chrono::nanoseconds slack = std::chrono::nanoseconds(0)) {
+			callback_t event_callback(std::forward<F>(callback));
+			if (!event_callback) return false;
+			return init_event(interval, mode, std::move(event_callback), spin, slack);
 		}
 
 		bool create_event(
@@ -130,82 +263,53 @@ namespace ztime {
 				const TimerMode mode,
 				void (*callback_ptr)(void *user_data),
 				void *user_data = nullptr) {
-			std::unique_lock<std::mutex> lock(m_event_mtx);
-			if (m_event_init) return false;
 			if (!callback_ptr) return false;
-			m_event_init = true;
-			lock.unlock();
-
-			period_ms = interval_ms;
-			m_mode = mode;
-			m_user_data = user_data;
-			m_callback_ptr = callback_ptr;
-
-			m_timer_future = std::async(std::launch::async, [this]() {
-				using ms_t = std::chrono::duration<uint32_t, std::ratio<1, 1000>>;
-				using ms64_t = std::chrono::duration<uint64_t, std::ratio<1, 1000>>;
-
-				if (m_mode == TimerMode::ONE_SHOT_AFTER_INTERVAL) {
-					m_event_start_time = clock_t::now();
-				}
-				std::chrono::time_point<clock_t> start_time = clock_t::now();
-
-				while (!false) {
-					std::this_thread::sleep_for(std::chrono::milliseconds(1));
-
-					if (m_shutdown) return;
-					if (!period_ms) continue;
-
-					if (m_mode == TimerMode::ONE_SHOT_AFTER_INTERVAL) {
-						std::unique_lock<std::mutex> lock(m_event_time);
-						const uint64_t elapsed = get_elapsed<uint64_t, ms64_t>(m_event_start_time);
-						if (elapsed < period_ms) continue;
-						if (m_once_event) continue;
-						m_once_event = true;
-						lock.unlock();
-						m_callback_ptr(m_user_data);
-						continue;
-					}
-
-					const uint32_t elapsed = get_elapsed<uint32_t, ms_t>(start_time);
-
-					if (elapsed >= period_ms) {
-						if (m_mode == TimerMode::STRICT_INTERVAL) {
-							start_time = clock_t::now();
-						}
-						m_callback_ptr(m_user_data);
-						if (m_mode == TimerMode::UNSTABLE_INTERVAL) {
-							start_time = clock_t::now();
-						}
-					}
-				}
+			return create_event(interval_ms, mode, [callback_ptr, user_data]() {
+				callback_ptr(user_data);
 			});
-			return true;
 		}
 
-		bool create_event(const std::function<void()> &callback) {
-			return create_event(0, TimerMode::UNSTABLE_INTERVAL, callback);
+		template<class F>
+		bool create_event(F &&callback) {
+			return create_event(0, TimerMode::UNSTABLE_INTERVAL, std::forward<F>(callback));
 		}
 
+		/** \brief Set the period of the timer event with nanosecond resolution
+		 * period_ms gets the period rounded down to milliseconds
+		 * \param period Period of the event
+		 */
+		void set_period(const std::chrono::nanoseconds period) noexcept;
+
+		/** \brief Get the period of the timer event
+		 */
+		inline std::chrono::nanoseconds get_period() const noexcept {
+			return std::chrono::nanoseconds(m_period_ns.load());
+		}
+
+		/** \brief Get the statistics of the shared timer service
+		 * Lateness and execution time of callbacks are recorded for all timers of the service.
+		 * TimerStats is declared in parts/ztime_timer_service.hpp
+		 */
+		static TimerStats get_event_stats() noexcept;
+
+		/** \brief Configure the threads of the shared timer service
+		 * The configuration is applied to the thread of the service and to its pool of callbacks.
+		 * ThreadConfig is declared in parts/ztime_thread_config.hpp
+		 * \param config Name, CPUs, scheduling policy and memory locking
+		 * \return Returns true if all settings were applied
+		 */
+		static bool set_thread_config(const ThreadConfig &config);
+
 		/** \brief Reset the event timer counter
 		 * This method resets the event timer counter in ONE_SHOT_AFTER_INTERVAL mode
 		 * The method should be called within the specified interval to prevent the timer from calling the callback
 		 */
-		inline void reset_event() noexcept {
-			std::unique_lock<std::mutex> lock(m_event_time);
-			m_once_event = false;
-			m_event_start_time = clock_t::now();
-		}
+		void reset_event() noexcept;
 
-		inline void stop_event() {
-			if(m_timer_future.valid()) {
-				m_shutdown = true;
-				try {
-					m_timer_future.wait();
-					m_timer_future.get();
-				} catch(...) {}
-			}
-		}
+		/** \brief Stop the timer event
+		 * After the return the callback is not running, unless the method is called from the callback
+		 */
+		void stop_event();
 
 		inline void set_name(const std::string &name) noexcept {
 			std::unique_lock<std::mutex> lock(m_name_mtx);
@@ -354,19 +458,42 @@ namespace ztime {
 		std::string m_name;
 		std::mutex	m_name_mtx;
 
-		std::mutex							m_event_time;
-		std::chrono::time_point<clock_t>	m_event_start_time;
-		bool								m_once_event = false;
-
 		TimerMode				m_mode = TimerMode::UNSTABLE_INTERVAL;
-		void					(*m_callback_ptr)(void *user_data) = nullptr;
-		void					*m_user_data = nullptr;
-		std::function<void()>	m_callback = nullptr;
-		std::future<void>		m_timer_future;
+		callback_t				m_callback;
+		uint64_t				m_event_id = 0;			/**< Id of the event in the timer service */
+		std::atomic<uint64_t>	m_period_ns = ATOMIC_VAR_INIT(0);
+		uint64_t				m_spin_ns = 0;			/**< Busy-spin tail before the deadline */
+		uint64_t				m_slack_ns = 0;			/**< Allowed delay after the deadline */
 		std::mutex				m_event_mtx;
 		bool					m_event_init = false;
 
 		std::atomic<bool> m_shutdown = ATOMIC_VAR_INIT(false);
+
+		/** \brief Initialize the event and add it to the timer service
+		 * \return Returns false if the event has already been created
+		 */
+		bool init_event(
+			const std::chrono::nanoseconds interval,
+			const TimerMode mode,
+			callback_t &&callback,
+			const std::chrono::nanoseconds spin,
+			const std::chrono::nanoseconds slack);
+
+		/** \brief Add the event to the timer service
+		 * STRICT_INTERVAL keeps a fixed rate, UNSTABLE_INTERVAL counts the period
+		 * from the end of the callback, ONE_SHOT_AFTER_INTERVAL is stopped after the call until reset_event()
+		 */
+		void add_event();
+
+		/** \brief Apply the current value of period_ms
+		 * The value is read under the lock, so the last of concurrent changes is applied
+		 */
+		void update_period_ms() noexcept;
+
+		/** \brief Apply a new value of the period, m_event_mtx is locked
+		 * The one-shot event stays stopped after the call until reset_event()
+		 */
+		void update_period() noexcept;
 	};
 
 }
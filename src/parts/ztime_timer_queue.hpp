@@ -0,0 +1,493 @@
+/*
+* ztime_cpp - Library for work with time.
+*
+* Copyright (c) 2018 Elektro Yar. Email: git.electroyar@gmail.com
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#pragma once
+#ifndef ZTIME_TIMER_QUEUE_HPP_INCLUDED
+#define ZTIME_TIMER_QUEUE_HPP_INCLUDED
+
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+
+namespace ztime {
+
+    /// Backends of timer queues
+    enum TimerBackend {
+        TIMER_HEAP = 0,     ///< Binary min-heap, O(log n) operations, exact deadlines
+        TIMER_WHEEL,        ///< Hierarchical timing wheel, O(1) operations, deadlines rounded up to a tick
+    };
+
+    /** \brief Node of a timer queue
+     * Timers are stored in the queues intrusively, the queues do not allocate nodes.
+     * Deadlines are measured in nanoseconds of a monotonic clock.
+     */
+    struct TimerNode {
+        uint64_t    deadline = 0;       /**< Deadline, ns */
+        size_t      heap_index = 0;     /**< Position in the heap */
+        TimerNode   *prev = nullptr;    /**< Previous node in the slot of the wheel */
+        TimerNode   *next = nullptr;    /**< Next node in the slot of the wheel */
+        uint32_t    slot = 0;           /**< Slot of the wheel */
+        bool        is_queued = false;
+    };
+
+    /** \brief Interface of a timer queue
+     */
+    class TimerQueue {
+    public:
+        static const uint64_t NO_DEADLINE = std::numeric_limits<uint64_t>::max();
+
+        virtual ~TimerQueue() {};
+
+        /** \brief Add a node
+         * \param node Node with the deadline set
+         */
+        virtual void push(TimerNode *node) = 0;
+
+        /** \brief Remove a node
+         * \param node Node in the queue
+         */
+        virtual void erase(TimerNode *node) = 0;
+
+        /** \brief Move a node after its deadline has changed
+         * \param node Node in the queue
+         */
+        virtual void update(TimerNode *node) = 0;
+
+        /** \brief Add or move several nodes
+         * The default implementation updates the nodes one by one
+         * \param nodes Nodes with the deadlines set
+         * \param count Number of nodes
+         */
+        virtual void update_many(TimerNode *const *nodes, const size_t count) {
+            for (size_t i = 0; i < count; ++i) {
+                update(nodes[i]);
+            }
+        }
+
+        /** \brief Remove several nodes
+         * The default implementation erases the nodes one by one
+         * \param nodes Nodes, the nodes which are not in the queue are skipped
+         * \param count Number of nodes
+         */
+        virtual void erase_many(TimerNode *const *nodes, const size_t count) {
+            for (size_t i = 0; i < count; ++i) {
+                erase(nodes[i]);
+            }
+        }
+
+        /** \brief Take the next expired node
+         * \param now Current time, ns
+         * \return Node with deadline <= now (removed from the queue) or nullptr
+         */
+        virtual TimerNode *pop_due(const uint64_t now) = 0;
+
+        /** \brief Get the node which is taken first without removing it
+         * \return Node or nullptr if the queue does not know the first node
+         */
+        virtual TimerNode *top() const noexcept = 0;
+
+        /** \brief Get the time when the queue must be checked next
+         * The value is never later than the earliest deadline
+         * \return Time in ns or NO_DEADLINE if the queue is empty
+         */
+        virtual uint64_t next_deadline() const noexcept = 0;
+
+        /** \brief Remove all nodes
+         */
+        virtual void clear() noexcept = 0;
+
+        virtual size_t size() const noexcept = 0;
+
+        inline bool empty() const noexcept {
+            return size() == 0;
+        }
+    };
+
+    /** \brief Timer queue based on an indexed binary min-heap
+     */
+    class TimerHeap final : public TimerQueue {
+    public:
+
+        void push(TimerNode *node) override {
+            node->heap_index = m_heap.size();
+            node->is_queued = true;
+            m_heap.push_back(node);
+            sift_up(node->heap_index);
+        }
+
+        void erase(TimerNode *node) override {
+            if (!node->is_queued) return;
+            node->is_queued = false;
+            const size_t index = node->heap_index;
+            const size_t last = m_heap.size() - 1;
+            if (index != last) {
+                swap(index, last);
+                m_heap.pop_back();
+                sift_up(index);
+                sift_down(index);
+            } else {
+                m_heap.pop_back();
+            }
+        }
+
+        void update(TimerNode *node) override {
+            if (!node->is_queued) {
+                push(node);
+                return;
+            }
+            sift_up(node->heap_index);
+            sift_down(node->heap_index);
+        }
+
+        /** \brief Add or move several nodes
+         * A large batch is appended and the heap is rebuilt in O(n)
+         */
+        void update_many(TimerNode *const *nodes, const size_t count) override {
+            if (!is_bulk(count)) {
+                TimerQueue::update_many(nodes, count);
+                return;
+            }
+            m_heap.reserve(m_heap.size() + count);
+            for (size_t i = 0; i < count; ++i) {
+                // queued nodes keep their positions, the rebuild restores the order
+                if (nodes[i]->is_queued) continue;
+                nodes[i]->is_queued = true;
+                m_heap.push_back(nodes[i]);
+            }
+            make_heap();
+        }
+
+        /** \brief Remove several nodes
+         * A large batch is filtered out and the heap is rebuilt in O(n)
+         */
+        void erase_many(TimerNode *const *nodes, const size_t count) override {
+            if (!is_bulk(count)) {
+                TimerQueue::erase_many(nodes, count);
+                return;
+            }
+            for (size_t i = 0; i < count; ++i) {
+                nodes[i]->is_queued = false;
+            }
+            m_heap.erase(std::remove_if(m_heap.begin(), m_heap.end(),
+                [](const TimerNode *node) { return !node->is_queued; }), m_heap.end());
+            make_heap();
+        }
+
+        TimerNode *pop_due(const uint64_t now) override {
+            if (m_heap.empty() || m_heap.front()->deadline > now) return nullptr;
+            TimerNode *node = m_heap.front();
+            erase(node);
+            return node;
+        }
+
+        TimerNode *top() const noexcept override {
+            return m_heap.empty() ? nullptr : m_heap.front();
+        }
+
+        uint64_t next_deadline() const noexcept override {
+            return m_heap.empty() ? NO_DEADLINE : m_heap.front()->deadline;
+        }
+
+        void clear() noexcept override {
+            for (size_t i = 0; i < m_heap.size(); ++i) {
+                m_heap[i]->is_queued = false;
+            }
+            m_heap.clear();
+        }
+
+        size_t size() const noexcept override {
+            return m_heap.size();
+        }
+
+    private:
+        std::vector<TimerNode*> m_heap;
+
+        /** \brief Check that a rebuild of the heap is cheaper than count operations of O(log n)
+         */
+        inline bool is_bulk(const size_t count) const noexcept {
+            return count >= 16 && count * 4 >= m_heap.size();
+        }
+
+        /** \brief Rebuild the heap from the bottom up (Floyd), O(n)
+         */
+        inline void make_heap() noexcept {
+            for (size_t i = 0; i < m_heap.size(); ++i) {
+                m_heap[i]->heap_index = i;
+            }
+            for (size_t i = m_heap.size() / 2; i-- > 0;) {
+                sift_down(i);
+            }
+        }
+
+        inline bool less(const size_t a, const size_t b) const noexcept {
+            return m_heap[a]->deadline < m_heap[b]->deadline;
+        }
+
+        inline void swap(const size_t a, const size_t b) noexcept {
+            std::swap(m_heap[a], m_heap[b]);
+            m_heap[a]->heap_index = a;
+            m_heap[b]->heap_index = b;
+        }
+
+        inline void sift_up(size_t index) noexcept {
+            while (index > 0) {
+                const size_t parent = (index - 1) / 2;
+                if (!less(index, parent)) break;
+                swap(index, parent);
+                index = parent;
+            }
+        }
+
+        inline void sift_down(size_t index) noexcept {
+            const size_t size = m_heap.size();
+            while (true) {
+                const size_t left = 2 * index + 1;
+                if (left >= size) break;
+                const size_t right = left + 1;
+                const size_t child = (right < size && less(right, left)) ? right : left;
+                if (!less(child, index)) break;
+                swap(index, child);
+                index = child;
+            }
+        }
+    };
+
+    /** \brief Hierarchical timing wheel
+     *
+     * The wheel has LEVELS levels of 64 slots, a slot of level L covers 64^L ticks.
+     * A timer is placed on the level of the highest 6-bit group in which its
+     * expiration tick differs from the current tick, so add, erase and update
+     * are O(1). When the current tick enters a slot of an upper level, the slot
+     * is cascaded to the lower levels. Occupancy bitmaps of the levels allow to
+     * skip empty ticks, so the wheel does not need a periodic tick.
+     * Timers beyond the range of the wheel wait in the overflow list.
+     * Deadlines are rounded up to the tick, timers never expire early.
+     */
+    class TimerWheel final : public TimerQueue {
+    public:
+        static const uint32_t LEVELS = 6;
+        static const uint32_t SLOT_BITS = 6;
+        static const uint32_t SLOTS = 1 << SLOT_BITS;
+        static const uint32_t OVERFLOW_LIST = LEVELS * SLOTS;
+        static const uint32_t READY_LIST = OVERFLOW_LIST + 1;
+
+        /** \brief Constructor of the wheel
+         * \param tick_ns   Duration of a tick, ns
+         * \param now       Current time, ns
+         */
+        TimerWheel(const uint64_t tick_ns = 1000000, const uint64_t now = 0) :
+                m_tick_ns(tick_ns ? tick_ns : 1),
+                m_current(now / (tick_ns ? tick_ns : 1)) {
+            m_lists.fill(nullptr);
+            m_occupied.fill(0);
+        }
+
+        void push(TimerNode *node) override {
+            node->is_queued = true;
+            ++m_size;
+            place(node, to_tick(node->deadline));
+        }
+
+        void erase(TimerNode *node) override {
+            if (!node->is_queued) return;
+            node->is_queued = false;
+            --m_size;
+            unlink(node);
+        }
+
+        void update(TimerNode *node) override {
+            erase(node);
+            push(node);
+        }
+
+        TimerNode *pop_due(const uint64_t now) override {
+            if (!m_lists[READY_LIST]) {
+                if (!m_size) {
+                    m_current = std::max(m_current, now / m_tick_ns);
+                    return nullptr;
+                }
+                advance(now / m_tick_ns);
+                if (!m_lists[READY_LIST]) return nullptr;
+            }
+            TimerNode *node = m_lists[READY_LIST];
+            erase(node);
+            return node;
+        }
+
+        /** \brief Get the first expired node
+         * Nodes of the future ticks are not ordered, so only expired nodes are returned
+         */
+        TimerNode *top() const noexcept override {
+            return m_lists[READY_LIST];
+        }
+
+        uint64_t next_deadline() const noexcept override {
+            if (!m_size) return NO_DEADLINE;
+            if (m_lists[READY_LIST]) return 0;
+            const uint64_t tick = next_tick();
+            return tick > NO_DEADLINE / m_tick_ns ? NO_DEADLINE : tick * m_tick_ns;
+        }
+
+        void clear() noexcept override {
+            for (size_t i = 0; i < m_lists.size(); ++i) {
+                TimerNode *node = m_lists[i];
+                while (node) {
+                    node->is_queued = false;
+                    node = node->next;
+                }
+            }
+            m_lists.fill(nullptr);
+            m_occupied.fill(0);
+            m_size = 0;
+        }
+
+        size_t size() const noexcept override {
+            return m_size;
+        }
+
+        inline uint64_t get_tick_ns() const noexcept {
+            return m_tick_ns;
+        }
+
+    private:
+        std::array<TimerNode*, LEVELS * SLOTS + 2>  m_lists;    /**< Slots of all levels, overflow and ready lists */
+        std::array<uint64_t, LEVELS>                m_occupied; /**< Bitmaps of non-empty slots */
+        uint64_t    m_tick_ns;
+        uint64_t    m_current;                                  /**< Current tick */
+        size_t      m_size = 0;
+
+        inline uint64_t to_tick(const uint64_t deadline) const noexcept {
+            // rounding up, the timer must not expire before its deadline
+            return deadline / m_tick_ns + (deadline % m_tick_ns ? 1 : 0);
+        }
+
+        static inline uint32_t get_group(const uint64_t tick, const uint32_t level) noexcept {
+            return (uint32_t)((tick >> (level * SLOT_BITS)) & (SLOTS - 1));
+        }
+
+        inline void link(TimerNode *node, const uint32_t list) noexcept {
+            node->slot = list;
+            node->prev = nullptr;
+            node->next = m_lists[list];
+            if (node->next) node->next->prev = node;
+            m_lists[list] = node;
+            if (list < OVERFLOW_LIST) {
+                m_occupied[list / SLOTS] |= (uint64_t)1 << (list % SLOTS);
+            }
+        }
+
+        inline void unlink(TimerNode *node) noexcept {
+            const uint32_t list = node->slot;
+            if (node->prev) node->prev->next = node->next;
+            else m_lists[list] = node->next;
+            if (node->next) node->next->prev = node->prev;
+            node->prev = node->next = nullptr;
+            if (list < OVERFLOW_LIST && !m_lists[list]) {
+                m_occupied[list / SLOTS] &= ~((uint64_t)1 << (list % SLOTS));
+            }
+        }
+
+        inline void place(TimerNode *node, const uint64_t tick) noexcept {
+            if (tick <= m_current) {
+                link(node, READY_LIST);
+                return;
+            }
+            const uint32_t level = (uint32_t)(63 - __builtin_clzll(tick ^ m_current)) / SLOT_BITS;
+            if (level >= LEVELS) {
+                link(node, OVERFLOW_LIST);
+                return;
+            }
+            link(node, level * SLOTS + get_group(tick, level));
+        }
+
+        /** \brief Get the next tick at which a slot expires or must be cascaded
+         */
+        inline uint64_t next_tick() const noexcept {
+            uint64_t best = std::numeric_limits<uint64_t>::max();
+            for (uint32_t level = 0; level < LEVELS; ++level) {
+                const uint32_t shift = level * SLOT_BITS;
+                const uint32_t group = get_group(m_current, level);
+                const uint64_t mask = group == (SLOTS - 1) ? 0 : (~(uint64_t)0 << (group + 1));
+                const uint64_t bits = m_occupied[level] & mask;
+                if (!bits) continue;
+                const uint64_t slot = (uint64_t)__builtin_ctzll(bits);
+                const uint64_t upper = (m_current >> (shift + SLOT_BITS)) << (shift + SLOT_BITS);
+                const uint64_t tick = upper | (slot << shift);
+                if (tick < best) best = tick;
+            }
+            if (m_lists[OVERFLOW_LIST]) {
+                const uint32_t shift = LEVELS * SLOT_BITS;
+                const uint64_t tick = ((m_current >> shift) + 1) << shift;
+                if (tick < best) best = tick;
+            }
+            return best;
+        }
+
+        /** \brief Move the nodes of a list to the levels below
+         */
+        inline void cascade(const uint32_t list) noexcept {
+            TimerNode *node = m_lists[list];
+            m_lists[list] = nullptr;
+            if (list < OVERFLOW_LIST) {
+                m_occupied[list / SLOTS] &= ~((uint64_t)1 << (list % SLOTS));
+            }
+            while (node) {
+                TimerNode *next = node->next;
+                place(node, to_tick(node->deadline));
+                node = next;
+            }
+        }
+
+        /** \brief Advance the current tick up to the target tick
+         */
+        void advance(const uint64_t target) noexcept {
+            while (m_current < target) {
+                const uint64_t tick = next_tick();
+                if (tick > target) {
+                    m_current = target;
+                    break;
+                }
+                m_current = tick;
+                if (m_lists[OVERFLOW_LIST] && !(m_current & ((((uint64_t)1) << (LEVELS * SLOT_BITS)) - 1))) {
+                    cascade(OVERFLOW_LIST);
+                }
+                for (uint32_t level = LEVELS - 1; level > 0; --level) {
+                    const uint32_t shift = level * SLOT_BITS;
+                    if (m_current & ((((uint64_t)1) << shift) - 1)) continue;
+                    const uint32_t list = level * SLOTS + get_group(m_current, level);
+                    if (m_lists[list]) cascade(list);
+                }
+                const uint32_t list = get_group(m_current, 0);
+                if (m_lists[list]) cascade(list);
+                if (m_lists[READY_LIST]) break;
+            }
+        }
+    };
+
+}; // ztime
+
+#endif // ZTIME_TIMER_QUEUE_HPP_INCLUDED
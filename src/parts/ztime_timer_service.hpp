@@ -0,0 +1,1394 @@
+/*
+* ztime_cpp - Library for work with time.
+*
+* Copyright (c) 2018 Elektro Yar. Email: git.electroyar@gmail.com
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#pragma once
+#ifndef ZTIME_TIMER_SERVICE_HPP_INCLUDED
+#define ZTIME_TIMER_SERVICE_HPP_INCLUDED
+
+#include <functional>
+#include <thread>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <vector>
+#include <memory>
+#include <limits>
+#include <algorithm>
+#include "ztime_timer_queue.hpp"
+#include "ztime_executor.hpp"
+#include "ztime_slot_map.hpp"
+#include "ztime_histogram.hpp"
+#include "ztime_clock.hpp"
+#include "ztime_inplace_function.hpp"
+#include "ztime_thread_config.hpp"
+
+#if defined(__linux__)
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
+#include <sys/prctl.h>
+#include <sys/epoll.h>
+#include <poll.h>
+#include <unistd.h>
+#include <time.h>
+#endif
+
+namespace ztime {
+
+    /// Modes of periodic timers
+    enum TimerRepeat {
+        FIXED_RATE = 0,     ///< The next deadline is the previous deadline plus the period, missed periods are skipped
+        FIXED_DELAY,        ///< The next deadline is the end of the callback plus the period
+    };
+
+    /// Threads of timer services
+    enum TimerLoop {
+        OWN_THREAD = 0,     ///< The service runs in its own thread
+        EXTERNAL_LOOP,      ///< The service runs in the event loop of the user, see TimerService::process_due()
+    };
+
+    /** \brief Counters and histograms of the timer service
+     * Histograms are in ns, except the depth of the queue.
+     */
+    struct TimerStats {
+        uint64_t wakeups = 0;       /**< Wake-ups of the thread of the service */
+        uint64_t batches = 0;       /**< Evaluations of deadlines which fired timers */
+        uint64_t expirations = 0;   /**< Fired timers */
+        uint64_t coalesced = 0;     /**< Timers fired inside their slack by the wake-up of another timer */
+        uint64_t skipped = 0;       /**< Periods skipped by late FIXED_RATE timers */
+        size_t size = 0;            /**< Timers in the service */
+        HistogramSnapshot lateness; /**< Start of the callback minus the deadline */
+        HistogramSnapshot duration; /**< Execution time of the callback */
+        HistogramSnapshot depth;    /**< Timers left in the queue after each batch */
+
+        /** \brief Get the number of wake-ups saved by batching of timers
+         */
+        inline uint64_t get_saved_wakeups() const noexcept {
+            return expirations - batches;
+        }
+    };
+
+    /** \brief Intrusive lock-free multi-producer single-consumer queue
+     *
+     * Producers push with one atomic exchange and never wait for each other
+     * or for the consumer. Only one thread may pop. Based on the algorithm
+     * of D. Vyukov.
+     */
+    class MpscQueue {
+    public:
+        struct Node {
+            std::atomic<Node*> next = ATOMIC_VAR_INIT(nullptr);
+        };
+
+        MpscQueue() : m_head(&m_stub), m_tail(&m_stub) {};
+
+        MpscQueue(const MpscQueue &) = delete;
+        MpscQueue &operator=(const MpscQueue &) = delete;
+
+        /** \brief Push a node, can be called from any thread
+         */
+        inline void push(Node *node) noexcept {
+            node->next.store(nullptr, std::memory_order_relaxed);
+            Node *prev = m_head.exchange(node);
+            prev->next.store(node, std::memory_order_release);
+        }
+
+        /** \brief Pop a node, can be called only from the consumer thread
+         * \return Node or nullptr if the queue is empty or a producer has not finished the push
+         */
+        inline Node *pop() noexcept {
+            Node *tail = m_tail;
+            Node *next = tail->next.load(std::memory_order_acquire);
+            if (tail == &m_stub) {
+                if (!next) return nullptr;
+                m_tail = next;
+                tail = next;
+                next = next->next.load(std::memory_order_acquire);
+            }
+            if (next) {
+                m_tail = next;
+                return tail;
+            }
+            if (tail != m_head.load()) return nullptr;
+            push(&m_stub);
+            next = tail->next.load(std::memory_order_acquire);
+            if (next) {
+                m_tail = next;
+                return tail;
+            }
+            return nullptr;
+        }
+
+        /** \brief Check that the queue is empty, can be called only from the consumer thread
+         */
+        inline bool empty() const noexcept {
+            if (m_tail->next.load(std::memory_order_acquire)) return false;
+            return m_head.load() == m_tail;
+        }
+
+    private:
+        std::atomic<Node*>  m_head;
+        Node                *m_tail;
+        Node                m_stub;
+    };
+
+    /** \brief Lock-free pool of nodes
+     *
+     * Nodes are allocated in blocks and go back to the heap only with the pool,
+     * so a node which is taken by one thread may still be read by another.
+     * The free list is a stack of indexes of nodes. The head of the stack
+     * has a tag which changes on every push and pop, so a thread with a stale
+     * head fails the compare-and-swap (ABA problem). Only the growth of the pool
+     * by a block locks. When the blocks run out, nodes are allocated one by one.
+     */
+    template<class T, size_t BLOCK_SIZE = 256, size_t MAX_BLOCKS = 1024>
+    class NodePool {
+    public:
+        static const uint32_t NO_INDEX = std::numeric_limits<uint32_t>::max();
+
+        struct Node {
+            uint32_t                pool_index = NO_INDEX;              /**< Index in the pool, NO_INDEX - the node is allocated in the heap */
+            std::atomic<uint32_t>   next_free = ATOMIC_VAR_INIT(0);     /**< Index of the next free node plus one, 0 - the end of the list */
+        };
+
+        NodePool() {
+            std::fill(m_blocks, m_blocks + MAX_BLOCKS, nullptr);
+        };
+
+        NodePool(const NodePool &) = delete;
+        NodePool &operator=(const NodePool &) = delete;
+
+        ~NodePool() {
+            for (size_t i = 0; i < m_num_blocks; ++i) {
+                delete[] m_blocks[i];
+            }
+        }
+
+        /** \brief Take a free node, can be called from any thread
+         * The node keeps the state it was released with
+         */
+        inline T *acquire() {
+            uint64_t head = m_head.load(std::memory_order_acquire);
+            while (true) {
+                const uint32_t top = (uint32_t)head;
+                if (!top) {
+                    if (!grow()) return new T();
+                    head = m_head.load(std::memory_order_acquire);
+                    continue;
+                }
+                T *node = &m_blocks[(top - 1) / BLOCK_SIZE][(top - 1) % BLOCK_SIZE];
+                const uint64_t next = get_tag(head) | node->next_free.load(std::memory_order_relaxed);
+                if (m_head.compare_exchange_weak(head, next, std::memory_order_acquire, std::memory_order_acquire)) {
+                    return node;
+                }
+            }
+        }
+
+        /** \brief Return the node to the pool, can be called from any thread
+         */
+        inline void release(T *node) {
+            if (node->pool_index == NO_INDEX) {
+                delete node;
+                return;
+            }
+            push(node, node);
+        }
+
+    private:
+        std::atomic<uint64_t>   m_head = ATOMIC_VAR_INIT(0);    /**< Tag in the high half, index of the top node plus one in the low half */
+        std::mutex              m_mutex;
+        T                       *m_blocks[MAX_BLOCKS];
+        size_t                  m_num_blocks = 0;
+
+        /** \brief Get the next tag of the head in the high half
+         */
+        static inline uint64_t get_tag(const uint64_t head) noexcept {
+            return ((head >> 32) + 1) << 32;
+        }
+
+        /** \brief Push the chain of nodes from the first to the last
+         */
+        inline void push(T *first, T *last) {
+            uint64_t head = m_head.load(std::memory_order_relaxed);
+            while (true) {
+                last->next_free.store((uint32_t)head, std::memory_order_relaxed);
+                const uint64_t next = get_tag(head) | (first->pool_index + 1);
+                if (m_head.compare_exchange_weak(head, next, std::memory_order_release, std::memory_order_relaxed)) {
+                    return;
+                }
+            }
+        }
+
+        /** \brief Add a block of nodes to the free list
+         * \return Returns false if the pool has no more blocks
+         */
+        bool grow() {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            // another thread has added a block or released a node
+            if ((uint32_t)m_head.load(std::memory_order_acquire)) return true;
+            if (m_num_blocks == MAX_BLOCKS) return false;
+            T *block = new T[BLOCK_SIZE];
+            const uint32_t first = (uint32_t)(m_num_blocks * BLOCK_SIZE);
+            for (size_t i = 0; i < BLOCK_SIZE; ++i) {
+                block[i].pool_index = first + (uint32_t)i;
+                block[i].next_free.store(first + (uint32_t)i + 2, std::memory_order_relaxed);
+            }
+            m_blocks[m_num_blocks++] = block;
+            push(&block[0], &block[BLOCK_SIZE - 1]);
+            return true;
+        }
+    };
+
+    /** \brief Timer service
+     *
+     * The service keeps timers in a deadline-ordered queue which is owned by
+     * one thread of the service. Methods which change timers do not lock:
+     * they push a command to a lock-free queue, and the thread drains the
+     * commands in a batch before each evaluation of deadlines. Between
+     * deadlines the thread sleeps on a timerfd with an absolute deadline
+     * (Linux) or on a condition variable. Due callbacks are called in the
+     * thread of the service or by an executor.
+     * A timer is never executed in parallel with itself.
+     *
+     * Ids of timers are generational handles of slots (SlotHandle): the thread
+     * finds a timer by the index of its slot in O(1), and the id of a removed
+     * timer never matches the next timer in the same slot. A timer keeps its
+     * slot in a lock-free pool, so add() does not lock either.
+     *
+     * Periods have nanosecond resolution. A timer may have a busy-spin tail:
+     * the thread wakes up spin_ns before the deadline and spins until the
+     * deadline, which trades CPU time for lower jitter.
+     *
+     * A timer may have a slack: it may fire up to slack_ns after the deadline.
+     * The thread wakes up by the end of the slack, and every timer whose window
+     * has begun fires in the same wake-up, like the timer slack of Linux.
+     * The queue TIMER_WHEEL batches the timers only inside one tick.
+     *
+     * The callback returns the next period in nanoseconds, 0 removes the timer,
+     * DISARM keeps the timer stopped until reset(). A timer with the period 0
+     * waits until set_period() is called.
+     *
+     * A service created with a VirtualClock has no thread and measures time by
+     * the clock: VirtualClock::advance_to() runs the due callbacks in its thread,
+     * spin tails, slack and executors are ignored.
+     *
+     * A service created with EXTERNAL_LOOP has no thread either: the event loop
+     * of the user waits for get_fd() to become readable (epoll, poll) and calls
+     * process_due(), which runs the due callbacks in the thread of the loop.
+     */
+    class TimerService : public VirtualClock::Listener {
+    public:
+        static const size_t CALLBACK_SIZE = 64;                               /**< Capacity of a callback, bytes */
+        typedef InplaceFunction<uint64_t(), CALLBACK_SIZE> callback_t;     /**< Callback, stored without heap allocations */
+
+        static const uint64_t NS_PER_MS = 1000000;
+        static const uint64_t DISARM = std::numeric_limits<uint64_t>::max(); /**< Result of the callback which stops the timer without removing */
+
+        /** \brief Parameters of a timer for add_many()
+         */
+        struct TimerSpec {
+            callback_t  callback;               /**< Callback, returns the next period in ns, 0 to remove the timer or DISARM */
+            uint64_t    period_ns = 0;          /**< Period in ns, 0 - the timer waits for set_period() */
+            TimerRepeat mode = FIXED_RATE;      /**< Mode of the period */
+            uint64_t    spin_ns = 0;            /**< Busy-spin tail before the deadline in ns */
+            uint64_t    slack_ns = 0;           /**< Allowed delay after the deadline in ns */
+
+            TimerSpec() {};
+
+            TimerSpec(
+                    callback_t c,
+                    const uint64_t p,
+                    const TimerRepeat m = FIXED_RATE,
+                    const uint64_t spin = 0,
+                    const uint64_t slack = 0) :
+                callback(std::move(c)), period_ns(p), mode(m), spin_ns(spin), slack_ns(slack) {};
+        };
+
+        /** \brief Constructor of the service
+         * \param backend   Timer queue
+         * \param executor  Executor of callbacks, nullptr - the thread of the service
+         */
+        TimerService(
+                const TimerBackend backend = TIMER_HEAP,
+                std::shared_ptr<Executor> executor = nullptr) :
+                m_queue(make_queue(backend)),
+                m_backend(backend),
+                m_executor(std::move(executor)) {
+            open_fds();
+            m_thread = std::thread([this] {
+                work();
+            });
+        }
+
+        /** \brief Constructor of the service for an event loop of the user
+         * \param loop      OWN_THREAD or EXTERNAL_LOOP
+         * \param backend   Timer queue
+         */
+        explicit TimerService(
+                const TimerLoop loop,
+                const TimerBackend backend = TIMER_HEAP) :
+                m_queue(make_queue(backend)),
+                m_backend(backend) {
+            open_fds();
+            if (loop == OWN_THREAD) {
+                m_thread = std::thread([this] {
+                    work();
+                });
+                return;
+            }
+            m_is_loop = true;
+            // producers wake the loop up through the eventfd until process_due() is called
+            m_sleeping.store(true);
+#           if defined(__linux__)
+            m_loop_fd = epoll_create1(EPOLL_CLOEXEC);
+            if (m_loop_fd < 0) return;
+            struct epoll_event event = {};
+            event.events = EPOLLIN;
+            event.data.fd = m_timer_fd;
+            epoll_ctl(m_loop_fd, EPOLL_CTL_ADD, m_timer_fd, &event);
+            event.data.fd = m_event_fd;
+            epoll_ctl(m_loop_fd, EPOLL_CTL_ADD, m_event_fd, &event);
+#           endif
+        }
+
+        /** \brief Constructor of the service driven by a virtual clock
+         * \param clock     Virtual clock
+         * \param backend   Timer queue
+         */
+        explicit TimerService(
+                std::shared_ptr<VirtualClock> clock,
+                const TimerBackend backend = TIMER_HEAP) :
+                m_clock(std::move(clock)),
+                m_queue(make_queue(backend)),
+                m_backend(backend),
+                m_is_loop(true) {
+            m_clock->subscribe(this);
+        }
+
+        TimerService(const TimerService &) = delete;
+        TimerService &operator=(const TimerService &) = delete;
+
+        ~TimerService() {
+            remove_all();
+            if (m_clock) {
+                m_clock->unsubscribe(this);
+            } else if (!m_is_loop) {
+                post(make_command(CMD_SHUTDOWN));
+                if (m_thread.get_id() == std::this_thread::get_id()) m_thread.detach();
+                else m_thread.join();
+            }
+            // executor threads may still be inside post()
+            while (m_in_flight.load()) {
+                std::this_thread::yield();
+            }
+            while (MpscQueue::Node *node = m_commands.pop()) {
+                Command *command = static_cast<Command*>(node);
+                if (command->type == CMD_ADD) free_event(command->event);
+                for (size_t i = 0; i < command->events.size(); ++i) {
+                    free_event(command->events[i]);
+                }
+                release_command(command);
+            }
+            // timers of the pool are destroyed with the pool
+            for (size_t i = 0; i < m_events.size(); ++i) {
+                if (m_events[i]) free_event(m_events[i]);
+            }
+#           if defined(__linux__)
+            if (m_loop_fd >= 0) close(m_loop_fd);
+            if (m_timer_fd >= 0) close(m_timer_fd);
+            if (m_event_fd >= 0) close(m_event_fd);
+#           endif
+        }
+
+        /** \brief Get the descriptor for the event loop of the user
+         * The descriptor (epoll of a timerfd and an eventfd) becomes readable when
+         * the earliest deadline passes or a timer is changed, then process_due()
+         * should be called. Only for EXTERNAL_LOOP in Linux.
+         * \return File descriptor or -1
+         */
+        inline int get_fd() const noexcept {
+            return m_loop_fd;
+        }
+
+        /** \brief Run the due callbacks in the calling thread
+         * For EXTERNAL_LOOP. Commands of other threads are processed first,
+         * then the timerfd is armed for the next deadline.
+         * Without get_fd() the loop may wait until get_next_deadline().
+         * Spin tails are waited in the calling thread, executors are ignored.
+         * \return Number of called timers
+         */
+        size_t process_due() {
+            std::lock_guard<std::recursive_mutex> lock(m_loop_mutex);
+            m_sleeping.store(false);
+            m_wakeups.fetch_add(1, std::memory_order_relaxed);
+#           if defined(__linux__)
+            uint64_t value = 0;
+            if (m_event_fd >= 0 && read(m_event_fd, &value, sizeof(value)) < 0) {};
+            if (m_timer_fd >= 0 && read(m_timer_fd, &value, sizeof(value)) < 0) {};
+#           endif
+            drain();
+            std::vector<Event*> due;
+            collect_due(get_now(), due);
+            const size_t count = due.size();
+            if (count) {
+                m_batches.fetch_add(1, std::memory_order_relaxed);
+                m_expirations.fetch_add(count, std::memory_order_relaxed);
+                m_depth.record(m_queue->size());
+                dispatch(due);
+            }
+            while (true) {
+                drain();
+                // a deadline which has already passed makes the descriptor readable at once
+                arm_timer(m_queue->next_deadline());
+                m_sleeping.store(true);
+                if (m_commands.empty()) break;
+                m_sleeping.store(false);
+            }
+            return count;
+        }
+
+        /** \brief Add a timer
+         * \param callback  Callback, returns the next period in ns, 0 to remove the timer or DISARM
+         * \param period_ns Period in ns, 0 - the timer waits for set_period()
+         * \param mode      Mode of the period
+         * \param spin_ns   Busy-spin tail before the deadline in ns, 0 - no spinning
+         * \param slack_ns  Allowed delay after the deadline in ns for batching of wake-ups
+         * \return Id of the timer, a generational handle of a slot of the service
+         */
+        uint64_t add(
+                callback_t callback,
+                const uint64_t period_ns,
+                const TimerRepeat mode = FIXED_RATE,
+                const uint64_t spin_ns = 0,
+                const uint64_t slack_ns = 0) {
+            Event *event = allocate_event();
+            event->callback = std::move(callback);
+            event->start = get_now();
+            event->period = period_ns;
+            event->spin = spin_ns;
+            event->slack = slack_ns;
+            event->mode = mode;
+            ++m_size;
+            const uint64_t id = event->id;
+            post(make_command(CMD_ADD, id, event));
+            return id;
+        }
+
+        /** \brief Add several timers
+         * The free lists are locked once and the thread of the service gets one command,
+         * which puts all timers to the queue at once (the heap is rebuilt in O(n))
+         * \param specs Parameters of the timers, the callbacks are moved out
+         * \return Ids of the timers in the order of the parameters
+         */
+        std::vector<uint64_t> add_many(std::vector<TimerSpec> &specs) {
+            std::vector<uint64_t> ids(specs.size());
+            if (specs.empty()) return ids;
+            Command *command = make_command(CMD_ADD_MANY);
+            command->events.resize(specs.size());
+            allocate_events(command->events);
+            const uint64_t start = get_now();
+            for (size_t i = 0; i < specs.size(); ++i) {
+                Event *event = command->events[i];
+                event->callback = std::move(specs[i].callback);
+                event->start = start;
+                event->period = specs[i].period_ns;
+                event->spin = specs[i].spin_ns;
+                event->slack = specs[i].slack_ns;
+                event->mode = specs[i].mode;
+                ids[i] = event->id;
+            }
+            m_size += specs.size();
+            post(command);
+            return ids;
+        }
+
+        /** \brief Change the period of the timer
+         * The countdown is not restarted, the new deadline is the last start plus the new period
+         * \param id        Id of the timer
+         * \param period_ns Period in ns, 0 - stop the timer
+         * \param is_arm    Start the timer if it was stopped by DISARM
+         */
+        void set_period(const uint64_t id, const uint64_t period_ns, const bool is_arm = false) {
+            Command *command = make_command(CMD_PERIOD, id);
+            command->value = period_ns;
+            command->is_arm = is_arm;
+            post(command);
+        }
+
+        /** \brief Restart the countdown of the timer
+         * A reset during the callback restarts the timer after the callback,
+         * even if the callback returns 0 or DISARM
+         * \param id Id of the timer
+         */
+        void reset(const uint64_t id) {
+            Command *command = make_command(CMD_RESET, id);
+            command->value = get_now();
+            post(command);
+        }
+
+        /** \brief Cancel the timer without waiting
+         * The running callback of the timer may still be executed after the return
+         * \param id Id of the timer
+         */
+        void cancel(const uint64_t id) {
+            post(make_command(CMD_CANCEL, id));
+        }
+
+        /** \brief Remove the timer
+         * Waits for the running callback of the timer, unless it is called from a callback
+         * \param id Id of the timer
+         */
+        void remove(const uint64_t id) {
+            if (current_event()) {
+                cancel(id);
+                return;
+            }
+            Waiter waiter;
+            Command *command = make_command(CMD_CANCEL, id);
+            command->waiter = &waiter;
+            post(command);
+            wait(waiter);
+        }
+
+        /** \brief Remove several timers
+         * The thread of the service gets one command, which takes the timers out of the queue at once.
+         * Waits for the running callbacks of the timers, unless it is called from a callback
+         * \param ids Ids of the timers
+         */
+        void remove_many(const std::vector<uint64_t> &ids) {
+            if (ids.empty()) return;
+            Command *command = make_command(CMD_CANCEL_MANY);
+            command->ids = ids;
+            if (current_event()) {
+                post(command);
+                return;
+            }
+            Waiter waiter;
+            command->waiter = &waiter;
+            post(command);
+            wait(waiter);
+        }
+
+        /** \brief Remove all timers
+         * Waits for running callbacks, unless it is called from a callback
+         */
+        void remove_all() {
+            Command *command = make_command(CMD_CANCEL_ALL);
+            if (current_event()) {
+                post(command);
+                return;
+            }
+            Waiter waiter;
+            command->waiter = &waiter;
+            post(command);
+            wait(waiter);
+        }
+
+        /** \brief Get the number of timers
+         */
+        inline size_t size() const noexcept {
+            return m_size;
+        }
+
+        /** \brief Set the backend of the timer queue
+         * Timers are moved to the new queue
+         */
+        void set_backend(const TimerBackend backend) {
+            Command *command = make_command(CMD_BACKEND);
+            command->value = backend;
+            post(command);
+        }
+
+        /** \brief Set the executor of callbacks
+         * \param executor Executor, nullptr - callbacks are called in the thread of the service
+         */
+        void set_executor(std::shared_ptr<Executor> executor) {
+            Command *command = make_command(CMD_EXECUTOR);
+            command->executor = std::move(executor);
+            post(command);
+        }
+
+        /** \brief Configure the thread of the service and the threads of its executor
+         * The configuration is applied by the thread of the service. A service without
+         * a thread has nothing to configure, the thread of the loop is configured
+         * by apply_thread_config(). Called from a callback, the configuration is applied
+         * after the callback and the result is not known.
+         * \param config Configuration
+         * \return Returns true if all settings were applied
+         */
+        bool set_thread_config(const ThreadConfig &config) {
+            if (m_is_loop) return false;
+            Command *command = make_command(CMD_THREAD_CONFIG);
+            command->config.reset(new ThreadConfig(config));
+            if (current_event()) {
+                post(command);
+                return true;
+            }
+            Waiter waiter;
+            command->waiter = &waiter;
+            post(command);
+            wait(waiter);
+            return waiter.is_ok;
+        }
+
+        /** \brief Get a snapshot of the counters and histograms of the service
+         * Statistics are recorded with relaxed atomics and never block the service.
+         */
+        inline TimerStats get_stats() const noexcept {
+            TimerStats stats;
+            stats.wakeups = m_wakeups.load(std::memory_order_relaxed);
+            stats.batches = m_batches.load(std::memory_order_relaxed);
+            stats.expirations = m_expirations.load(std::memory_order_relaxed);
+            stats.coalesced = m_coalesced.load(std::memory_order_relaxed);
+            stats.skipped = m_skipped.load(std::memory_order_relaxed);
+            stats.size = m_size.load(std::memory_order_relaxed);
+            stats.lateness = m_lateness.get_snapshot();
+            stats.duration = m_duration.get_snapshot();
+            stats.depth = m_depth.get_snapshot();
+            return stats;
+        }
+
+        /** \brief Get the shared timer service
+         * The shared service has one thread for deadlines and a small pool for callbacks.
+         * The service is never destroyed, so it can be used by static objects.
+         */
+        static inline TimerService &get_shared() {
+            static TimerService *service = new TimerService(
+                TIMER_HEAP,
+                std::make_shared<ThreadPoolExecutor>(
+                    std::min(4u, std::max(2u, std::thread::hardware_concurrency()))));
+            return *service;
+        }
+
+        /** \brief Get the current time of the monotonic clock
+         * \return Time of the monotonic clock, ns
+         */
+        static inline uint64_t now_ns() noexcept {
+            return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                clock_t::now().time_since_epoch()).count();
+        }
+
+        /** \brief Get the current time of the service
+         * \return Time of the virtual clock or of the monotonic clock, ns
+         */
+        inline uint64_t get_now() const noexcept {
+            return m_clock ? m_clock->get_time_ns() : now_ns();
+        }
+
+        /** \brief Get the nearest deadline of a service without a thread
+         * \return Time of the clock of the service in ns, TimerQueue::NO_DEADLINE if there are no timers
+         */
+        uint64_t get_next_deadline() override {
+            std::lock_guard<std::recursive_mutex> lock(m_loop_mutex);
+            drain();
+            return m_queue->next_deadline();
+        }
+
+        /** \brief Run the due callbacks of the service driven by a virtual clock
+         * Called by VirtualClock::advance_to()
+         * \param t Current time of the clock, ns
+         */
+        void run_until(const uint64_t t) override {
+            std::lock_guard<std::recursive_mutex> lock(m_loop_mutex);
+            std::vector<Event*> due;
+            while (true) {
+                drain();
+                while (Event *event = static_cast<Event*>(m_queue->pop_due(t))) {
+                    event->is_running = true;
+                    due.push_back(event);
+                }
+                if (due.empty()) break;
+                m_batches.fetch_add(1, std::memory_order_relaxed);
+                m_expirations.fetch_add(due.size(), std::memory_order_relaxed);
+                m_depth.record(m_queue->size());
+                for (size_t i = 0; i < due.size(); ++i) {
+                    complete(due[i], run(due[i], due[i]->start + due[i]->period));
+                }
+                due.clear();
+            }
+        }
+
+    private:
+        using clock_t = std::chrono::steady_clock;
+
+        struct Waiter {
+            size_t  count = 1;          /**< Number of signals before the waiter is done */
+            bool    is_done = false;
+            bool    is_ok = true;       /**< Result of the command */
+        };
+
+        struct Event;
+
+        static const size_t EVENT_BLOCK_SIZE = 1024;
+        static const size_t EVENT_MAX_BLOCKS = 4096;
+        typedef NodePool<Event, EVENT_BLOCK_SIZE, EVENT_MAX_BLOCKS> EventPool;  /**< Timers by the index of the slot, 4M timers */
+
+        struct Event : public TimerNode, public EventPool::Node {
+            callback_t          callback;
+            uint64_t            start = 0;              /**< Beginning of the current period, ns */
+            uint64_t            period = 0;             /**< Period, ns */
+            uint64_t            spin = 0;               /**< Busy-spin tail before the deadline, ns */
+            uint64_t            slack = 0;              /**< Allowed delay after the deadline, ns */
+            uint64_t            id = 0;
+            TimerRepeat         mode = FIXED_RATE;
+            bool                is_armed = true;        /**< The timer is not stopped by DISARM */
+            bool                is_running = false;     /**< The callback is being executed */
+            bool                is_reset = false;       /**< The timer was reset during the callback */
+            std::atomic<bool>   is_cancelled = ATOMIC_VAR_INIT(false);
+            std::vector<Waiter*> waiters;               /**< Waiters for the removal */
+            uint32_t            generation = 1;         /**< Generation of the slot for the next id */
+        };
+
+        enum CommandType {
+            CMD_ADD = 0,
+            CMD_ADD_MANY,
+            CMD_PERIOD,
+            CMD_RESET,
+            CMD_CANCEL,
+            CMD_CANCEL_MANY,
+            CMD_CANCEL_ALL,
+            CMD_COMPLETE,
+            CMD_BACKEND,
+            CMD_EXECUTOR,
+            CMD_THREAD_CONFIG,
+            CMD_SHUTDOWN,
+        };
+
+        struct Command : public MpscQueue::Node, public NodePool<Command>::Node {
+            CommandType                     type = CMD_ADD;
+            uint64_t                        id = 0;
+            uint64_t                        value = 0;
+            Event                           *event = nullptr;
+            Waiter                          *waiter = nullptr;
+            std::shared_ptr<Executor>       executor;
+            std::vector<Event*>             events;     /**< Timers of CMD_ADD_MANY */
+            std::vector<uint64_t>           ids;        /**< Ids of CMD_CANCEL_MANY */
+            std::unique_ptr<ThreadConfig>   config;     /**< Configuration of CMD_THREAD_CONFIG */
+            bool                            is_arm = false;
+        };
+
+        // state of producers
+        std::shared_ptr<VirtualClock>       m_clock;
+        std::recursive_mutex                m_loop_mutex;           /**< Lock of the state of a service without a thread */
+        MpscQueue                           m_commands;
+        NodePool<Command>                   m_command_pool;         /**< Command nodes for reuse */
+        EventPool                           m_event_pool;           /**< Timers for reuse, the index in the pool is the slot */
+        std::mutex                          m_ids_mutex;            /**< Lock of the slots beyond the pool */
+        std::vector<uint64_t>               m_free_ids;             /**< Ids of free slots beyond the pool with the next generation */
+        uint32_t                            m_num_slots = (uint32_t)(EVENT_BLOCK_SIZE * EVENT_MAX_BLOCKS);
+        std::atomic<size_t>                 m_size = ATOMIC_VAR_INIT(0);
+        std::atomic<bool>                   m_sleeping = ATOMIC_VAR_INIT(false);
+        std::atomic<size_t>                 m_in_flight = ATOMIC_VAR_INIT(0);  /**< Callbacks dispatched to the executor */
+        std::mutex                          m_mutex;
+        std::condition_variable             m_cv;
+        std::condition_variable             m_done_cv;
+        int                                 m_timer_fd = -1;
+        int                                 m_event_fd = -1;
+        int                                 m_loop_fd = -1;
+        std::atomic<uint64_t>               m_wakeups = ATOMIC_VAR_INIT(0);
+        std::atomic<uint64_t>               m_batches = ATOMIC_VAR_INIT(0);
+        std::atomic<uint64_t>               m_expirations = ATOMIC_VAR_INIT(0);
+        std::atomic<uint64_t>               m_coalesced = ATOMIC_VAR_INIT(0);
+        std::atomic<uint64_t>               m_skipped = ATOMIC_VAR_INIT(0);
+        Histogram                           m_lateness;
+        Histogram                           m_duration;
+        Histogram                           m_depth;
+
+        // state of the thread of the service
+        std::vector<Event*>                 m_events;               /**< Timers by the index of the slot */
+        std::unique_ptr<TimerQueue>         m_queue;
+        TimerBackend                        m_backend;
+        std::shared_ptr<Executor>           m_executor;
+        std::vector<Waiter*>                m_all_waiters;          /**< Waiters of remove_all() */
+        bool                                m_is_loop = false;      /**< The service has no thread */
+        size_t                              m_cancelled_running = 0;
+        bool                                m_shutdown = false;
+
+        std::thread                         m_thread;
+
+        inline std::unique_ptr<TimerQueue> make_queue(const TimerBackend backend) {
+            if (backend == TIMER_WHEEL) {
+                return std::unique_ptr<TimerQueue>(new TimerWheel(NS_PER_MS, get_now()));
+            }
+            return std::unique_ptr<TimerQueue>(new TimerHeap());
+        }
+
+        static inline clock_t::time_point to_time_point(const uint64_t t) noexcept {
+            return clock_t::time_point(std::chrono::duration_cast<clock_t::duration>(std::chrono::nanoseconds(t)));
+        }
+
+        /** \brief Timer whose callback is executed by the current thread
+         */
+        static inline const Event *&current_event() noexcept {
+            static thread_local const Event *event = nullptr;
+            return event;
+        }
+
+        /** \brief Take a command node from the pool
+         */
+        inline Command *make_command(const CommandType type, const uint64_t id = 0, Event *event = nullptr) {
+            Command *command = m_command_pool.acquire();
+            command->type = type;
+            command->id = id;
+            command->event = event;
+            return command;
+        }
+
+        /** \brief Clear the command and return it to the pool
+         */
+        inline void release_command(Command *command) {
+            command->value = 0;
+            command->event = nullptr;
+            command->waiter = nullptr;
+            command->executor.reset();
+            // a pooled node does not keep the memory of a large batch
+            if (command->events.capacity()) std::vector<Event*>().swap(command->events);
+            if (command->ids.capacity()) std::vector<uint64_t>().swap(command->ids);
+            command->config.reset();
+            command->is_arm = false;
+            m_command_pool.release(command);
+        }
+
+        /** \brief Push a command and wake up the thread of the service if it sleeps
+         */
+        inline void post(Command *command) {
+            m_commands.push(command);
+            if (!m_sleeping.load()) return;
+#           if defined(__linux__)
+            if (m_event_fd >= 0) {
+                const uint64_t value = 1;
+                if (write(m_event_fd, &value, sizeof(value)) < 0) {};
+                return;
+            }
+#           endif
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_cv.notify_one();
+        }
+
+        inline void open_fds() {
+#           if defined(__linux__)
+            m_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+            m_event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+#           endif
+        }
+
+        /** \brief Set the timerfd to the absolute deadline
+         * \param deadline Time of the monotonic clock in ns or TimerQueue::NO_DEADLINE
+         */
+        inline void arm_timer(const uint64_t deadline) {
+#           if defined(__linux__)
+            if (m_timer_fd < 0) return;
+            struct itimerspec spec = {};
+            if (deadline != TimerQueue::NO_DEADLINE) {
+                spec.it_value.tv_sec = (time_t)(deadline / 1000000000ULL);
+                spec.it_value.tv_nsec = (long)(deadline % 1000000000ULL);
+                if (!spec.it_value.tv_sec && !spec.it_value.tv_nsec) spec.it_value.tv_nsec = 1;
+            }
+            timerfd_settime(m_timer_fd, TFD_TIMER_ABSTIME, &spec, nullptr);
+#           else
+            (void)deadline;
+#           endif
+        }
+
+        /** \brief Sleep until the deadline or until a command is pushed
+         * \param deadline Time of the monotonic clock in ns or TimerQueue::NO_DEADLINE
+         */
+        void sleep_until(const uint64_t deadline) {
+#           if defined(__linux__)
+            if (m_timer_fd >= 0 && m_event_fd >= 0) {
+                // the eventfd keeps a wake-up which came before poll()
+                arm_timer(deadline);
+                struct pollfd fds[2] = {
+                    {m_event_fd, POLLIN, 0},
+                    {m_timer_fd, POLLIN, 0}
+                };
+                if (poll(fds, 2, -1) <= 0) return;
+                uint64_t value = 0;
+                if (fds[0].revents & POLLIN) {
+                    if (read(m_event_fd, &value, sizeof(value)) < 0) {};
+                }
+                if (fds[1].revents & POLLIN) {
+                    if (read(m_timer_fd, &value, sizeof(value)) < 0) {};
+                }
+                return;
+            }
+#           endif
+            std::unique_lock<std::mutex> lock(m_mutex);
+            // producers notify under the mutex, so the check does not lose a wake-up
+            if (!m_commands.empty()) return;
+            if (deadline == TimerQueue::NO_DEADLINE) m_cv.wait(lock);
+            else m_cv.wait_until(lock, to_time_point(deadline));
+        }
+
+        /** \brief Busy-wait until the time
+         * \param t Time of the monotonic clock in ns
+         */
+        static inline void spin_until(const uint64_t t) noexcept {
+            while (now_ns() < t) {};
+        }
+
+        inline void wait(Waiter &waiter) {
+            if (m_is_loop) {
+                // callbacks of a service without a thread run under the lock, the command is processed after them
+                std::lock_guard<std::recursive_mutex> lock(m_loop_mutex);
+                drain();
+                return;
+            }
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_done_cv.wait(lock, [&waiter] {
+                return waiter.is_done;
+            });
+        }
+
+        inline void signal(std::vector<Waiter*> &waiters) {
+            if (waiters.empty()) return;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                for (size_t i = 0; i < waiters.size(); ++i) {
+                    if (!--waiters[i]->count) waiters[i]->is_done = true;
+                }
+            }
+            waiters.clear();
+            m_done_cv.notify_all();
+        }
+
+        inline void signal(Waiter *waiter) {
+            if (!waiter) return;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (!--waiter->count) waiter->is_done = true;
+            }
+            m_done_cv.notify_all();
+        }
+
+        /** \brief Put the timer to the queue or take it out according to its state
+         */
+        inline void schedule(Event *event) {
+            if (event->is_running) return;
+            if (set_deadline(event)) {
+                m_queue->update(event);
+            } else {
+                m_queue->erase(event);
+            }
+        }
+
+        /** \brief Put several timers to the queue or take them out according to their state
+         */
+        void schedule_many(Event *const *events, const size_t count) {
+            std::vector<TimerNode*> nodes;
+            nodes.reserve(count);
+            for (size_t i = 0; i < count; ++i) {
+                if (events[i]->is_running) continue;
+                if (set_deadline(events[i])) nodes.push_back(events[i]);
+                else m_queue->erase(events[i]);
+            }
+            m_queue->update_many(nodes.data(), nodes.size());
+        }
+
+        /** \brief Set the deadline of the timer if it must be in the queue
+         * \return The timer must be in the queue
+         */
+        inline bool set_deadline(Event *event) const noexcept {
+            if (!event->is_armed || !event->period) return false;
+            // the queue is ordered by the end of the slack window
+            if (m_clock) event->deadline = event->start + event->period;
+            else event->deadline = get_wakeup(event) + event->slack;
+            return true;
+        }
+
+        /** \brief Get the earliest wake-up for the timer
+         * The thread wakes up before the deadline by the spin tail
+         */
+        static inline uint64_t get_wakeup(const Event *event) noexcept {
+            const uint64_t deadline = event->start + event->period;
+            return deadline > event->spin ? deadline - event->spin : 0;
+        }
+
+        inline void erase_event(Event *event) {
+            m_queue->erase(event);
+            m_events[SlotHandle::get_index(event->id)] = nullptr;
+            signal(event->waiters);
+            if (event->is_cancelled && event->is_running && !--m_cancelled_running) {
+                signal(m_all_waiters);
+            }
+            --m_size;
+            release_event(event);
+        }
+
+        /** \brief Find the timer, stale ids of removed timers are not found
+         */
+        inline Event *find_event(const uint64_t id) const noexcept {
+            const uint32_t index = SlotHandle::get_index(id);
+            if (index >= m_events.size()) return nullptr;
+            Event *event = m_events[index];
+            return event && event->id == id ? event : nullptr;
+        }
+
+        /** \brief Take a free timer for a new timer
+         * A timer of the pool keeps its slot: the index in the pool is the index
+         * of the slot, so the timer and its id are taken with one compare-and-swap
+         * and producers do not lock. Removed timers are reused without allocations.
+         * Only the timers beyond the pool take their slots from a locked free list.
+         */
+        inline Event *allocate_event() {
+            Event *event = m_event_pool.acquire();
+            if (event->pool_index != EventPool::NO_INDEX) {
+                event->id = SlotHandle::make(event->pool_index, event->generation);
+                return event;
+            }
+            std::lock_guard<std::mutex> lock(m_ids_mutex);
+            if (m_free_ids.empty()) {
+                event->id = SlotHandle::make(m_num_slots++, 1);
+            } else {
+                event->id = m_free_ids.back();
+                m_free_ids.pop_back();
+            }
+            return event;
+        }
+
+        /** \brief Take free timers for several new timers
+         * \param events Array of the size of the number of timers
+         */
+        inline void allocate_events(std::vector<Event*> &events) {
+            for (size_t i = 0; i < events.size(); ++i) {
+                events[i] = allocate_event();
+            }
+        }
+
+        inline void release_event(Event *event) {
+            const uint32_t pool_index = event->pool_index;
+            const uint32_t generation = SlotHandle::get_next_generation(SlotHandle::get_generation(event->id));
+            if (pool_index == EventPool::NO_INDEX) {
+                const uint64_t next_id = SlotHandle::make(SlotHandle::get_index(event->id), generation);
+                delete event;
+                std::lock_guard<std::mutex> lock(m_ids_mutex);
+                m_free_ids.push_back(next_id);
+                return;
+            }
+            // the link of the free list is not reset, a producer may still read it
+            static_cast<TimerNode&>(*event) = TimerNode();
+            event->callback = nullptr;
+            event->start = 0;
+            event->period = 0;
+            event->spin = 0;
+            event->slack = 0;
+            event->id = 0;
+            event->mode = FIXED_RATE;
+            event->is_armed = true;
+            event->is_running = false;
+            event->is_reset = false;
+            event->is_cancelled.store(false, std::memory_order_relaxed);
+            std::vector<Waiter*>().swap(event->waiters);
+            event->generation = generation;
+            m_event_pool.release(event);
+        }
+
+        /** \brief Destroy the timer of the service which is destroyed
+         */
+        inline void free_event(Event *event) {
+            if (event->pool_index == EventPool::NO_INDEX) delete event;
+        }
+
+        /** \brief Cancel the timer, running timers are removed after the callback
+         */
+        inline void cancel_event(Event *event, Waiter *waiter) {
+            if (!event->is_running) {
+                erase_event(event);
+                signal(waiter);
+                return;
+            }
+            if (!event->is_cancelled) {
+                event->is_cancelled = true;
+                ++m_cancelled_running;
+            }
+            if (waiter) event->waiters.push_back(waiter);
+        }
+
+        /** \brief Remove several timers which are not running
+         * The timers are taken out of the queue at once, then released
+         */
+        inline void cancel_many(std::vector<Event*> &events) {
+            std::vector<TimerNode*> nodes(events.begin(), events.end());
+            m_queue->erase_many(nodes.data(), nodes.size());
+            for (size_t i = 0; i < events.size(); ++i) {
+                erase_event(events[i]);
+            }
+        }
+
+        inline void drain() {
+            while (MpscQueue::Node *node = m_commands.pop()) {
+                process(static_cast<Command*>(node));
+            }
+        }
+
+        void process(Command *command) {
+            Event *event = nullptr;
+            switch (command->type) {
+            case CMD_ADD:
+                event = command->event;
+                {
+                    const uint32_t index = SlotHandle::get_index(event->id);
+                    if (index >= m_events.size()) m_events.resize(index + 1, nullptr);
+                    m_events[index] = event;
+                }
+                schedule(event);
+                break;
+            case CMD_ADD_MANY: {
+                    uint32_t max_index = 0;
+                    for (size_t i = 0; i < command->events.size(); ++i) {
+                        max_index = std::max(max_index, SlotHandle::get_index(command->events[i]->id));
+                    }
+                    if (max_index >= m_events.size()) m_events.resize(max_index + 1, nullptr);
+                    for (size_t i = 0; i < command->events.size(); ++i) {
+                        event = command->events[i];
+                        m_events[SlotHandle::get_index(event->id)] = event;
+                    }
+                    schedule_many(command->events.data(), command->events.size());
+                }
+                break;
+            case CMD_PERIOD:
+                if (!(event = find_event(command->id))) break;
+                event->period = command->value;
+                if (command->is_arm) event->is_armed = true;
+                schedule(event);
+                break;
+            case CMD_RESET:
+                if (!(event = find_event(command->id))) break;
+                event->start = command->value;
+                event->is_armed = true;
+                if (event->is_running) event->is_reset = true;
+                schedule(event);
+                break;
+            case CMD_CANCEL:
+                if (!(event = find_event(command->id))) {
+                    signal(command->waiter);
+                    break;
+                }
+                cancel_event(event, command->waiter);
+                break;
+            case CMD_CANCEL_MANY: {
+                    std::vector<Event*> events;
+                    events.reserve(command->ids.size());
+                    for (size_t i = 0; i < command->ids.size(); ++i) {
+                        if (!(event = find_event(command->ids[i]))) continue;
+                        if (event->is_running) {
+                            if (command->waiter) ++command->waiter->count;
+                            cancel_event(event, command->waiter);
+                        } else if (!event->is_cancelled) {
+                            // the flag skips a repeated id, the timer is released below
+                            event->is_cancelled = true;
+                            events.push_back(event);
+                        }
+                    }
+                    cancel_many(events);
+                    // the own count of the waiter, the running timers signal it after their callbacks
+                    signal(command->waiter);
+                }
+                break;
+            case CMD_CANCEL_ALL: {
+                    std::vector<Event*> events;
+                    events.reserve(m_events.size());
+                    for (size_t i = 0; i < m_events.size(); ++i) {
+                        if (!m_events[i]) continue;
+                        if (m_events[i]->is_running) cancel_event(m_events[i], nullptr);
+                        else events.push_back(m_events[i]);
+                    }
+                    cancel_many(events);
+                    if (command->waiter) {
+                        if (m_cancelled_running) m_all_waiters.push_back(command->waiter);
+                        else signal(command->waiter);
+                    }
+                }
+                break;
+            case CMD_COMPLETE:
+                complete(command->event, command->value);
+                break;
+            case CMD_BACKEND: {
+                    const TimerBackend backend = (TimerBackend)command->value;
+                    if (backend == m_backend) break;
+                    m_queue->clear();
+                    m_queue = make_queue(backend);
+                    m_backend = backend;
+                    std::vector<Event*> events;
+                    events.reserve(m_events.size());
+                    for (size_t i = 0; i < m_events.size(); ++i) {
+                        if (m_events[i]) events.push_back(m_events[i]);
+                    }
+                    schedule_many(events.data(), events.size());
+                }
+                break;
+            case CMD_EXECUTOR:
+                // callbacks of a service without a thread run in the thread of the loop
+                if (!m_is_loop) m_executor = std::move(command->executor);
+                break;
+            case CMD_THREAD_CONFIG: {
+                    bool is_ok = apply_thread_config(*command->config);
+                    if (m_executor && !m_executor->set_thread_config(*command->config)) is_ok = false;
+                    if (command->waiter) command->waiter->is_ok = is_ok;
+                    signal(command->waiter);
+                }
+                break;
+            case CMD_SHUTDOWN:
+                m_shutdown = true;
+                break;
+            };
+            release_command(command);
+        }
+
+        /** \brief Call the callback of the timer
+         * \param event    Timer
+         * \param deadline Deadline of the call, ns
+         * \return Result of the callback
+         */
+        inline uint64_t run(Event *event, const uint64_t deadline) {
+            if (event->is_cancelled) return 0;
+            const Event *prev_event = current_event();
+            current_event() = event;
+            const uint64_t begin = get_now();
+            const uint64_t result = event->callback();
+            const uint64_t end = get_now();
+            current_event() = prev_event;
+            m_lateness.record(begin > deadline ? begin - deadline : 0);
+            m_duration.record(end - begin);
+            return result;
+        }
+
+        /** \brief Schedule the next call of the timer after the callback
+         */
+        void complete(Event *event, const uint64_t result) {
+            if (event->is_cancelled || (!result && !event->is_reset)) {
+                // erase_event() counts the cancelled timers which were running
+                erase_event(event);
+                return;
+            }
+            event->is_running = false;
+            if (event->is_reset) {
+                event->is_reset = false;
+                if (result && result != DISARM) event->period = result;
+            } else if (result == DISARM) {
+                event->is_armed = false;
+            } else {
+                event->period = result;
+                if (event->mode == FIXED_DELAY) {
+                    event->start = get_now();
+                } else {
+                    event->start += event->period;
+                    const uint64_t now = get_now();
+                    if (now > event->start && (now - event->start) > event->period) {
+                        // missed periods are skipped
+                        const uint64_t skipped = (now - event->start - 1) / event->period;
+                        event->start += skipped * event->period;
+                        m_skipped.fetch_add(skipped, std::memory_order_relaxed);
+                    }
+                }
+            }
+            schedule(event);
+        }
+
+        /** \brief Take the due timers out of the queue
+         */
+        inline void collect_due(const uint64_t now, std::vector<Event*> &due) {
+            while (Event *event = static_cast<Event*>(m_queue->pop_due(now))) {
+                event->is_running = true;
+                due.push_back(event);
+            }
+            // timers whose slack window has begun join the wake-up
+            while (Event *event = static_cast<Event*>(m_queue->top())) {
+                if (get_wakeup(event) > now) break;
+                m_queue->erase(event);
+                event->is_running = true;
+                due.push_back(event);
+                m_coalesced.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        void work() {
+#           if defined(__linux__)
+            // the default slack of 50 us would be added to every wake-up
+            prctl(PR_SET_TIMERSLACK, 1UL, 0UL, 0UL, 0UL);
+#           endif
+            std::vector<Event*> due;
+            while (true) {
+                // commands are drained in a batch before the deadlines are evaluated
+                drain();
+                if (m_shutdown) break;
+
+                collect_due(now_ns(), due);
+                if (!due.empty()) {
+                    m_batches.fetch_add(1, std::memory_order_relaxed);
+                    m_expirations.fetch_add(due.size(), std::memory_order_relaxed);
+                    m_depth.record(m_queue->size());
+                    dispatch(due);
+                    due.clear();
+                    continue;
+                }
+
+                m_sleeping.store(true);
+                if (!m_commands.empty()) {
+                    m_sleeping.store(false);
+                    continue;
+                }
+                // producers wake the thread up when they push a command
+                sleep_until(m_queue->next_deadline());
+                m_sleeping.store(false);
+                m_wakeups.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        void dispatch(std::vector<Event*> &due) {
+            bool is_spin = false;
+            for (size_t i = 0; i < due.size(); ++i) {
+                if (due[i]->spin) is_spin = true;
+            }
+            if (is_spin && due.size() > 1) {
+                // timers are popped in the order of wake-ups, not deadlines
+                std::stable_sort(due.begin(), due.end(), [](const Event *a, const Event *b) {
+                    return a->start + a->period < b->start + b->period;
+                });
+            }
+            if (!m_executor || m_executor->is_inline()) {
+                for (size_t i = 0; i < due.size(); ++i) {
+                    if (due[i]->spin) spin_until(due[i]->start + due[i]->period);
+                    complete(due[i], run(due[i], due[i]->start + due[i]->period));
+                }
+                return;
+            }
+            for (size_t i = 0; i < due.size(); ++i) {
+                Event *event = due[i];
+                if (event->spin) spin_until(event->start + event->period);
+                // the deadline is read here, the thread of the service may change the period
+                const uint64_t deadline = event->start + event->period;
+                ++m_in_flight;
+                m_executor->execute([this, event, deadline] {
+                    Command *command = make_command(CMD_COMPLETE, event->id, event);
+                    command->value = run(event, deadline);
+                    post(command);
+                    --m_in_flight;
+                });
+            }
+        }
+    };
+
+}; // ztime
+
+#endif // ZTIME_TIMER_SERVICE_HPP_INCLUDED
@@ -23,6 +23,7 @@
 */
 
 #include "ztime.hpp"
+#include "parts/ztime_timer_service.hpp"
 
 #include <ctime>
 #include <thread>
@@ -30,12 +31,32 @@
 #include <algorithm>
 #include <cctype>
 #include <locale>
+#include <atomic>
+#if defined(__linux__)
+#include <cerrno>
+#endif
 
 namespace ztime {
 
+	static std::atomic<ClockSource*> current_clock(nullptr);
+
+	void set_clock(ClockSource *clock) noexcept {
+		current_clock.store(clock, std::memory_order_release);
+	}
+
+	ClockSource *get_clock() noexcept {
+		return current_clock.load(std::memory_order_acquire);
+	}
+
 	inline const struct timespec get_timespec() noexcept {
 		// https://en.cppreference.com/w/c/chrono/timespec_get
 		struct timespec ts;
+		if (const ClockSource *clock = current_clock.load(std::memory_order_acquire)) {
+			const uint64_t t = clock->get_time_ns();
+			ts.tv_sec = (time_t)(t / NS_PER_SEC);
+			ts.tv_nsec = (long)(t % NS_PER_SEC);
+			return ts;
+		}
 #			if defined(CLOCK_REALTIME)
 		clock_gettime(CLOCK_REALTIME, &ts); // Версия для POSIX
 #			else
@@ -1083,6 +1104,34 @@ namespace ztime {
 		return convert_cet_to_gmt(eet - SEC_PER_HOUR);
 	}
 
+	timestamp_t convert_gmt_to_zone(const timestamp_t gmt, const TimeZone zone) {
+		switch(zone) {
+		case CET:
+			return convert_gmt_to_cet(gmt);
+		case EET:
+			return convert_gmt_to_eet(gmt);
+		case MSK:
+			return convert_gmt_to_msk(gmt);
+		default:
+			break;
+		};
+		return gmt;
+	}
+
+	timestamp_t convert_zone_to_gmt(const timestamp_t local, const TimeZone zone) {
+		switch(zone) {
+		case CET:
+			return convert_cet_to_gmt(local);
+		case EET:
+			return convert_eet_to_gmt(local);
+		case MSK:
+			return local - (convert_gmt_to_msk(local) - local);
+		default:
+			break;
+		};
+		return local;
+	}
+
 	std::string get_str_date_time(const timestamp_t timestamp) {
 		DateTime iTime(timestamp);
 		return iTime.get_str_date_time();
@@ -1358,4 +1407,110 @@ namespace ztime {
 	void delay(const uint64_t seconds) {
 		std::this_thread::sleep_for(std::chrono::seconds(seconds));
 	}
+
+	void delay_until(const std::chrono::steady_clock::time_point deadline, const uint64_t spin_ns) {
+		const std::chrono::steady_clock::time_point wakeup = deadline - std::chrono::nanoseconds(spin_ns);
+#		if defined(__linux__)
+		// steady_clock is CLOCK_MONOTONIC, the absolute deadline does not drift after a signal
+		const int64_t t = std::chrono::duration_cast<std::chrono::nanoseconds>(wakeup.time_since_epoch()).count();
+		if (t > 0) {
+			struct timespec ts;
+			ts.tv_sec = (time_t)(t / NS_PER_SEC);
+			ts.tv_nsec = (long)(t % NS_PER_SEC);
+			while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {};
+		}
+#		else
+		std::this_thread::sleep_until(wakeup);
+#		endif
+		while (std::chrono::steady_clock::now() < deadline) {};
+	}
+
+	void delay_us(const uint64_t microseconds, const uint64_t spin_ns) {
+		delay_until(std::chrono::steady_clock::now() + std::chrono::microseconds(microseconds), spin_ns);
+	}
+
+	void delay_ns(const uint64_t nanoseconds, const uint64_t spin_ns) {
+		delay_until(std::chrono::steady_clock::now() + std::chrono::nanoseconds(nanoseconds), spin_ns);
+	}
+
+	TimerStats Timer::get_event_stats() noexcept {
+		return TimerService::get_shared().get_stats();
+	}
+
+	bool Timer::set_thread_config(const ThreadConfig &config) {
+		return TimerService::get_shared().set_thread_config(config);
+	}
+
+	void Timer::set_period(const std::chrono::nanoseconds period) noexcept {
+		std::lock_guard<std::mutex> lock(m_event_mtx);
+		m_period_ns = (uint64_t)period.count();
+		period_ms.m_value = (uint32_t)(m_period_ns / TimerService::NS_PER_MS);
+		update_period();
+	}
+
+	void Timer::reset_event() noexcept {
+		std::lock_guard<std::mutex> lock(m_event_mtx);
+		if (!m_event_init || m_shutdown) return;
+		if (m_mode != TimerMode::ONE_SHOT_AFTER_INTERVAL) return;
+		TimerService::get_shared().reset(m_event_id);
+	}
+
+	void Timer::stop_event() {
+		std::unique_lock<std::mutex> lock(m_event_mtx);
+		if (!m_event_init || m_shutdown) return;
+		m_shutdown = true;
+		const uint64_t id = m_event_id;
+		lock.unlock();
+		TimerService::get_shared().remove(id);
+	}
+
+	bool Timer::init_event(
+			const std::chrono::nanoseconds interval,
+			const TimerMode mode,
+			callback_t &&callback,
+			const std::chrono::nanoseconds spin,
+			const std::chrono::nanoseconds slack) {
+		std::lock_guard<std::mutex> lock(m_event_mtx);
+		if (m_event_init) return false;
+		m_event_init = true;
+
+		m_period_ns = (uint64_t)interval.count();
+		period_ms.m_value = (uint32_t)(m_period_ns / TimerService::NS_PER_MS);
+		m_spin_ns = (uint64_t)spin.count();
+		m_slack_ns = (uint64_t)slack.count();
+		m_mode = mode;
+		m_callback = std::move(callback);
+		add_event();
+		return true;
+	}
+
+	void Timer::add_event() {
+		const uint64_t period = m_period_ns.load();
+		if (m_mode == TimerMode::ONE_SHOT_AFTER_INTERVAL) {
+			m_event_id = TimerService::get_shared().add([this]()->uint64_t {
+				m_callback();
+				return TimerService::DISARM;
+			}, period, FIXED_RATE, m_spin_ns, m_slack_ns);
+			return;
+		}
+		m_event_id = TimerService::get_shared().add([this]()->uint64_t {
+			m_callback();
+			const uint64_t period = m_period_ns.load();
+			return period ? period : TimerService::DISARM;
+		}, period, m_mode == TimerMode::STRICT_INTERVAL ? FIXED_RATE : FIXED_DELAY, m_spin_ns, m_slack_ns);
+	}
+
+	void Timer::update_period_ms() noexcept {
+		std::lock_guard<std::mutex> lock(m_event_mtx);
+		m_period_ns = (uint64_t)period_ms.m_value.load() * TimerService::NS_PER_MS;
+		update_period();
+	}
+
+	void Timer::update_period() noexcept {
+		if (!m_event_init || m_shutdown) return;
+		TimerService::get_shared().set_period(
+			m_event_id,
+			m_period_ns.load(),
+			m_mode != TimerMode::ONE_SHOT_AFTER_INTERVAL);
+	}
 }
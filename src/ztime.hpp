@@ -32,6 +32,7 @@
 #include <algorithm>
 #include <cmath>
 #include "parts/ztime_timer.hpp"
+#include "parts/ztime_clock.hpp"
 #include "parts/ztime_definitions.hpp"
 
 #if __cplusplus <= 201103L
@@ -74,6 +75,19 @@ namespace ztime {
         return t_ms / (ftimestamp_t)MS_PER_SEC;
     }
 
+    /** \brief Установить источник текущего времени
+     * Функции текущего времени (get_timestamp, get_ftimestamp, get_millisecond и др.)
+     * будут брать время из источника, например из VirtualClock при воспроизведении данных.
+     * Источник должен существовать, пока он установлен.
+     * \param clock Источник времени, nullptr - системные часы
+     */
+    void set_clock(ClockSource *clock) noexcept;
+
+    /** \brief Получить источник текущего времени
+     * \return Источник времени, nullptr - системные часы
+     */
+    ClockSource *get_clock() noexcept;
+
     /** \brief Получить миллисекунду секунды
      * \return Миллисекунда секунды
      */
@@ -824,6 +838,22 @@ namespace ztime {
      */
     timestamp_t convert_msk_to_gmt(const timestamp_t msk);
 
+    /** \brief Convert GMT time to the time of the specified zone
+     * \param gmt   Timestamp, GMT time
+     * \param zone  Time zone (GMT, CET, EET, MSK)
+     * \return Time of the specified zone
+     */
+    timestamp_t convert_gmt_to_zone(const timestamp_t gmt, const TimeZone zone);
+
+    /** \brief Convert the time of the specified zone to GMT time
+     * For MSK the offset is taken at the moment of the local time, so the result
+     * may differ by one hour near the historical clock changes (before 2014).
+     * \param local Timestamp with the changed time zone
+     * \param zone  Time zone (GMT, CET, EET, MSK)
+     * \return GMT time
+     */
+    timestamp_t convert_zone_to_gmt(const timestamp_t local, const TimeZone zone);
+
     /** \brief Проверить начало получаса
      * \param timestamp метка времени
      * \return вернет true, если начало получаса
@@ -1470,6 +1500,126 @@ namespace ztime {
      */
     void delay(const uint64_t seconds);
 
+    /** \brief Задержка до момента времени монотонных часов
+     * Срок задается абсолютным временем, поэтому цикл с задержками до сроков
+     * не накапливает время выполнения своих итераций. В Linux поток спит
+     * в clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME), в остальных системах в sleep_until.
+     * Хвост активного ожидания будит поток раньше срока и ждет срок в цикле,
+     * это снижает дрожание ценой процессорного времени.
+     * \param deadline  Момент времени std::chrono::steady_clock
+     * \param spin_ns   Хвост активного ожидания, нс. 0 - без активного ожидания
+     */
+    void delay_until(const std::chrono::steady_clock::time_point deadline, const uint64_t spin_ns = 0);
+
+    /** \brief Задержка на указанное количество микросекунд
+     * \param microseconds  Количество микросекунд
+     * \param spin_ns       Хвост активного ожидания, нс. 0 - без активного ожидания
+     */
+    void delay_us(const uint64_t microseconds, const uint64_t spin_ns = 0);
+
+    /** \brief Задержка на указанное количество наносекунд
+     * \param nanoseconds   Количество наносекунд
+     * \param spin_ns       Хвост активного ожидания, нс. 0 - без активного ожидания
+     */
+    void delay_ns(const uint64_t nanoseconds, const uint64_t spin_ns = 0);
+
+    /** \brief Темп цикла с фиксированным периодом
+     *
+     * Сроки итераций отсчитываются от начала: срок k-й итерации равен началу
+     * плюс k периодов, поэтому время выполнения итераций не сдвигает темп.
+     * Если итерация не успела к сроку (overrun), пропущенные сроки
+     * пропускаются и цикл продолжает на сетке сроков, либо, в режиме
+     * догона, следующие итерации идут без ожидания, пока цикл не догонит сетку.
+     *
+     * Пример:
+     * ztime::Pacer pacer(std::chrono::microseconds(500));
+     * while (true) {
+     *     if (pacer.wait()) std::cout << "overrun" << std::endl;
+     *     send_order();
+     * }
+     */
+    class Pacer {
+    public:
+        typedef std::chrono::steady_clock clock_t;
+
+        /** \brief Конструктор темпа, отсчет начинается сразу
+         * \param period        Период итераций
+         * \param spin_ns       Хвост активного ожидания перед сроком, нс
+         * \param is_catch_up   Догонять пропущенные сроки итерациями без ожидания
+         */
+        Pacer(
+                const std::chrono::nanoseconds period,
+                const uint64_t spin_ns = 0,
+                const bool is_catch_up = false) :
+                m_period(period.count() > 0 ? period : std::chrono::nanoseconds(1)),
+                m_spin_ns(spin_ns),
+                m_is_catch_up(is_catch_up) {
+            reset();
+        }
+
+        /** \brief Ждать срок следующей итерации
+         * \return Количество пропущенных сроков, 0 - цикл успевает.
+         * В режиме догона каждая опоздавшая итерация возвращает 1
+         */
+        uint64_t wait() {
+            const clock_t::time_point now = clock_t::now();
+            uint64_t missed = 0;
+            if (now > m_next) {
+                if (m_is_catch_up) {
+                    // every missed deadline gets its own late iteration, each is counted once
+                    missed = 1;
+                } else {
+                    missed = (uint64_t)((now - m_next) / m_period) + 1;
+                    // the loop goes on at the first deadline ahead
+                    m_next += m_period * missed;
+                    delay_until(m_next, m_spin_ns);
+                }
+                m_overruns += missed;
+            } else {
+                delay_until(m_next, m_spin_ns);
+            }
+            m_next += m_period;
+            ++m_iterations;
+            return missed;
+        }
+
+        /** \brief Начать отсчет сроков заново от текущего времени
+         */
+        void reset() {
+            m_next = clock_t::now() + m_period;
+        }
+
+        /** \brief Получить срок следующей итерации
+         */
+        inline clock_t::time_point get_next_deadline() const noexcept {
+            return m_next;
+        }
+
+        inline std::chrono::nanoseconds get_period() const noexcept {
+            return m_period;
+        }
+
+        /** \brief Получить количество пропущенных сроков
+         */
+        inline uint64_t get_overruns() const noexcept {
+            return m_overruns;
+        }
+
+        /** \brief Получить количество итераций
+         */
+        inline uint64_t get_iterations() const noexcept {
+            return m_iterations;
+        }
+
+    private:
+        std::chrono::nanoseconds    m_period;
+        uint64_t                    m_spin_ns = 0;
+        bool                        m_is_catch_up = false;
+        clock_t::time_point         m_next;
+        uint64_t                    m_overruns = 0;
+        uint64_t                    m_iterations = 0;
+    };
+
     /** \brief Проверить пересечение периодов
      * \param a Первый период
      * \param b Второй период
@@ -0,0 +1,258 @@
+/*
+* ztime_cpp - Library for work with time.
+*
+* Copyright (c) 2018 Elektro Yar. Email: git.electroyar@gmail.com
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#pragma once
+#ifndef ZTIME_BAR_AGGREGATOR_HPP_INCLUDED
+#define ZTIME_BAR_AGGREGATOR_HPP_INCLUDED
+
+#include "ztime.hpp"
+#include <vector>
+#include <functional>
+
+namespace ztime {
+
+    /// Periods of bars in seconds
+    enum BarPeriods {
+        PERIOD_M1 = 60,
+        PERIOD_M5 = 300,
+        PERIOD_M15 = 900,
+        PERIOD_M30 = 1800,
+        PERIOD_H1 = 3600,
+        PERIOD_H4 = 14400,
+        PERIOD_D1 = 86400,
+        PERIOD_W1 = 0xFFFFFFFE, ///< Calendar week, starts on Sunday. Not a period, a fixed week is 604800
+        PERIOD_MN1 = 0xFFFFFFFF,///< Calendar month. Not a period
+    };
+
+    /** \brief Bar (candle) OHLCV
+     */
+    struct Bar {
+        timestamp_t timestamp = 0;  /**< Opening time of the bar */
+        double open = 0;
+        double high = 0;
+        double low = 0;
+        double close = 0;
+        double volume = 0;
+        uint64_t ticks = 0;         /**< Number of ticks in the bar */
+    };
+
+    /** \brief Streaming aggregator of ticks into bars
+     *
+     * The aggregator builds bars of several timeframes from one stream of ticks.
+     * Every timeframe keeps the timestamp of its next boundary, so a tick inside
+     * the current bar costs one comparison and the bar start is calculated only
+     * when a new bar opens. Bars are closed by the first tick of the next bar,
+     * by update() or by flush(). Ticks must go in ascending order.
+     * No memory is allocated after the timeframes are added.
+     */
+    class BarAggregator {
+    public:
+
+        /** \brief Callback of the bar closing
+         * The callback receives the closed bar and the period of its timeframe
+         */
+        typedef std::function<void(const Bar &bar, const uint32_t period)> callback_t;
+
+        BarAggregator() {};
+
+        BarAggregator(const callback_t &callback) : m_callback(callback) {};
+
+        /** \brief Set the callback of the bar closing
+         * \param callback Callback function
+         */
+        inline void set_callback(const callback_t &callback) {
+            m_callback = callback;
+        }
+
+        /** \brief Add a timeframe
+         * \param period Period of bars in seconds. PERIOD_W1 and PERIOD_MN1 are calendar week and month
+         * \return Returns the index of the timeframe
+         */
+        inline size_t add_timeframe(const uint32_t period) {
+            Timeframe frame;
+            frame.period = period ? period : 1;
+            m_frames.push_back(frame);
+            return m_frames.size() - 1;
+        }
+
+        /** \brief Get the number of timeframes
+         */
+        inline size_t size() const noexcept {
+            return m_frames.size();
+        }
+
+        /** \brief Push a tick
+         * \param t         Timestamp of the tick
+         * \param price     Price
+         * \param volume    Volume
+         */
+        inline void push(const timestamp_t t, const double price, const double volume = 0) {
+            for (size_t i = 0; i < m_frames.size(); ++i) {
+                Timeframe &frame = m_frames[i];
+                if (t >= frame.next) {
+                    close_bar(frame);
+                    open_bar(frame, t, price, volume);
+                    continue;
+                }
+                Bar &bar = frame.bar;
+                if (price > bar.high) bar.high = price;
+                if (price < bar.low) bar.low = price;
+                bar.close = price;
+                bar.volume += volume;
+                ++bar.ticks;
+            }
+        }
+
+        /** \brief Push columns of ticks
+         * Bars of each timeframe are closed in order, timeframes are processed one by one
+         * \param t         Array of timestamps
+         * \param price     Array of prices
+         * \param volume    Array of volumes, may be nullptr
+         * \param n         Number of ticks
+         */
+        void push(const timestamp_t *t, const double *price, const double *volume, const size_t n) {
+            for (size_t f = 0; f < m_frames.size(); ++f) {
+                Timeframe &frame = m_frames[f];
+                size_t i = 0;
+                while (i < n) {
+                    if (t[i] >= frame.next) {
+                        close_bar(frame);
+                        open_bar(frame, t[i], price[i], volume ? volume[i] : 0);
+                        ++i;
+                    }
+                    // the rest of the bar is scanned without boundary calculations
+                    Bar &bar = frame.bar;
+                    double high = bar.high;
+                    double low = bar.low;
+                    double sum = 0;
+                    const size_t start = i;
+                    while (i < n && t[i] < frame.next) {
+                        const double p = price[i];
+                        high = p > high ? p : high;
+                        low = p < low ? p : low;
+                        if (volume) sum += volume[i];
+                        ++i;
+                    }
+                    if (i == start) continue;
+                    bar.high = high;
+                    bar.low = low;
+                    bar.close = price[i - 1];
+                    bar.volume += sum;
+                    bar.ticks += i - start;
+                }
+            }
+        }
+
+        /** \brief Close bars which ended before the moment t
+         * This method allows to close bars by a timer without waiting for the next tick
+         * \param t Current timestamp
+         */
+        inline void update(const timestamp_t t) {
+            for (size_t i = 0; i < m_frames.size(); ++i) {
+                if (t >= m_frames[i].next) close_bar(m_frames[i]);
+            }
+        }
+
+        /** \brief Close all open bars
+         */
+        inline void flush() {
+            for (size_t i = 0; i < m_frames.size(); ++i) {
+                close_bar(m_frames[i]);
+            }
+        }
+
+        /** \brief Get the current bar of the timeframe
+         * \param index Index of the timeframe
+         * \return Current (not closed) bar
+         */
+        inline const Bar &get_bar(const size_t index) const {
+            return m_frames[index].bar;
+        }
+
+        /** \brief Check that the timeframe has an open bar
+         * \param index Index of the timeframe
+         */
+        inline bool is_open(const size_t index) const {
+            return m_frames[index].is_open;
+        }
+
+        /** \brief Remove all timeframes
+         */
+        inline void clear() noexcept {
+            m_frames.clear();
+        }
+
+        /** \brief Get the opening time of the bar
+         * \param period    Period of bars in seconds
+         * \param t         Timestamp
+         * \return Opening time of the bar which contains t
+         */
+        static inline timestamp_t get_bar_start(const uint32_t period, const timestamp_t t) noexcept {
+            if (period == PERIOD_W1) return get_week_start_first_timestamp(t);
+            if (period == PERIOD_MN1) return get_first_timestamp_month(t);
+            return get_first_timestamp_period(period, t);
+        }
+
+        /** \brief Get the opening time of the next bar
+         * \param period    Period of bars in seconds
+         * \param t         Timestamp
+         * \return Opening time of the bar following the bar which contains t
+         */
+        static inline timestamp_t get_bar_stop(const uint32_t period, const timestamp_t t) noexcept {
+            if (period == PERIOD_W1) return get_week_start_first_timestamp(t) + SEC_PER_WEEK;
+            if (period == PERIOD_MN1) return get_last_timestamp_month(t) + SEC_PER_DAY;
+            return get_first_timestamp_period(period, t) + period;
+        }
+
+    private:
+
+        struct Timeframe {
+            Bar bar;
+            timestamp_t next = 0;   /**< Opening time of the next bar */
+            uint32_t period = 0;
+            bool is_open = false;
+        };
+
+        std::vector<Timeframe>  m_frames;
+        callback_t              m_callback;
+
+        inline void open_bar(Timeframe &frame, const timestamp_t t, const double price, const double volume) noexcept {
+            Bar &bar = frame.bar;
+            bar.timestamp = get_bar_start(frame.period, t);
+            bar.open = bar.high = bar.low = bar.close = price;
+            bar.volume = volume;
+            bar.ticks = 1;
+            frame.next = get_bar_stop(frame.period, t);
+            frame.is_open = true;
+        }
+
+        inline void close_bar(Timeframe &frame) {
+            if (!frame.is_open) return;
+            frame.is_open = false;
+            if (m_callback) m_callback(frame.bar, frame.period);
+        }
+    };
+
+}; // ztime
+
+#endif // ZTIME_BAR_AGGREGATOR_HPP_INCLUDED
@@ -0,0 +1,280 @@
+/*
+* ztime_cpp - Library for work with time.
+*
+* Copyright (c) 2018 Elektro Yar. Email: git.electroyar@gmail.com
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#pragma once
+#ifndef ZTIME_BUCKETING_HPP_INCLUDED
+#define ZTIME_BUCKETING_HPP_INCLUDED
+
+#include "ztime.hpp"
+#include <vector>
+
+namespace ztime {
+
+    /// Units of calendar buckets
+    enum BucketUnit {
+        BUCKET_PERIOD = 0,  ///< Fixed period in seconds
+        BUCKET_WEEK,        ///< Calendar week, starts on Sunday
+        BUCKET_MONTH,       ///< Calendar month
+        BUCKET_QUARTER,     ///< Calendar quarter
+        BUCKET_YEAR,        ///< Calendar year
+    };
+
+    /** \brief Run of elements of one bucket
+     */
+    struct BucketSegment {
+        size_t bucket = 0;  /**< Index of the bucket */
+        size_t begin = 0;   /**< Index of the first element */
+        size_t end = 0;     /**< Index after the last element */
+
+        BucketSegment() {};
+
+        BucketSegment(const size_t b, const size_t s, const size_t e) :
+            bucket(b), begin(s), end(e) {};
+    };
+
+    /** \brief Calendar-aligned bucketing of timestamps
+     *
+     * The class builds a table of bucket boundaries covering the input range once,
+     * so months, quarters and years are calculated per bucket and not per element.
+     * Sorted input is assigned by a merge walk over the table, unsorted input by
+     * a binary search. Sorted input may be split into run-length segments directly.
+     */
+    class CalendarBuckets {
+    public:
+
+        static const uint32_t BUCKET_NONE = 0xFFFFFFFF;    /**< Index of elements outside of the table */
+
+        CalendarBuckets() {};
+
+        /** \brief Build the table of boundaries
+         * \param unit      Unit of buckets
+         * \param start     First timestamp of the range
+         * \param stop      Last timestamp of the range
+         * \param period    Period in seconds for BUCKET_PERIOD
+         * \return Returns true if the table has been built
+         */
+        bool build(
+                const BucketUnit unit,
+                const timestamp_t start,
+                const timestamp_t stop,
+                const uint32_t period = SEC_PER_DAY) {
+            m_boundaries.clear();
+            if (start > stop) return false;
+            if (unit == BUCKET_PERIOD && !period) return false;
+
+            timestamp_t t = get_bucket_start(unit, start, period);
+            m_boundaries.push_back(t);
+            while (t <= stop) {
+                t = get_next_bucket_start(unit, t, period);
+                m_boundaries.push_back(t);
+            }
+            return true;
+        }
+
+        /** \brief Build the table of boundaries covering an array of timestamps
+         * \param unit      Unit of buckets
+         * \param data      Array of timestamps
+         * \param n         Number of timestamps
+         * \param period    Period in seconds for BUCKET_PERIOD
+         * \return Returns true if the table has been built
+         */
+        bool build(
+                const BucketUnit unit,
+                const timestamp_t *data,
+                const size_t n,
+                const uint32_t period = SEC_PER_DAY) {
+            if (!n) {
+                m_boundaries.clear();
+                return false;
+            }
+            auto minmax = std::minmax_element(data, data + n);
+            return build(unit, *minmax.first, *minmax.second, period);
+        }
+
+        /** \brief Get the number of buckets
+         */
+        inline size_t size() const noexcept {
+            return m_boundaries.empty() ? 0 : m_boundaries.size() - 1;
+        }
+
+        /** \brief Get the table of boundaries
+         * \return Beginnings of the buckets and the end of the last bucket
+         */
+        inline const std::vector<timestamp_t> &get_boundaries() const noexcept {
+            return m_boundaries;
+        }
+
+        /** \brief Get the beginning of the bucket
+         * \param index Index of the bucket
+         */
+        inline timestamp_t get_start(const size_t index) const noexcept {
+            return m_boundaries[index];
+        }
+
+        /** \brief Get the end of the bucket
+         * \param index Index of the bucket
+         * \return Beginning of the next bucket
+         */
+        inline timestamp_t get_stop(const size_t index) const noexcept {
+            return m_boundaries[index + 1];
+        }
+
+        /** \brief Find the bucket of a timestamp
+         * \param t Timestamp
+         * \return Index of the bucket or BUCKET_NONE
+         */
+        inline uint32_t find(const timestamp_t t) const noexcept {
+            if (m_boundaries.empty() || t < m_boundaries.front() || t >= m_boundaries.back()) return BUCKET_NONE;
+            return (uint32_t)(std::upper_bound(m_boundaries.begin(), m_boundaries.end(), t) - m_boundaries.begin() - 1);
+        }
+
+        /** \brief Assign buckets to an array of timestamps
+         * Sorted input is processed by a merge walk, unsorted input by a binary search
+         * \param data  Array of timestamps
+         * \param n     Number of timestamps
+         * \param index Output array of bucket indexes (BUCKET_NONE for timestamps outside of the table)
+         */
+        void assign(const timestamp_t *data, const size_t n, uint32_t *index) const noexcept {
+            if (!n) return;
+            if (!std::is_sorted(data, data + n)) {
+                for (size_t i = 0; i < n; ++i) {
+                    index[i] = find(data[i]);
+                }
+                return;
+            }
+            size_t i = 0;
+            while (i < n && (m_boundaries.empty() || data[i] < m_boundaries.front())) {
+                index[i++] = BUCKET_NONE;
+            }
+            const size_t buckets = size();
+            size_t k = i < n ? find(data[i]) : 0;
+            for (; i < n; ++i) {
+                while (k < buckets && data[i] >= m_boundaries[k + 1]) ++k;
+                index[i] = k < buckets ? (uint32_t)k : BUCKET_NONE;
+            }
+        }
+
+        /** \brief Split an array of timestamps into run-length segments of buckets
+         *
+         * For sorted input one binary search per bucket is made, so the cost
+         * does not depend on the number of elements inside the buckets.
+         * Unsorted input gives a segment for every run of equal buckets.
+         * Elements outside of the table are skipped.
+         * \param data      Array of timestamps
+         * \param n         Number of timestamps
+         * \param segments  Output array of segments
+         */
+        template<class SEGMENT_CONTAINER_TYPE>
+        void segments(const timestamp_t *data, const size_t n, SEGMENT_CONTAINER_TYPE &segments) const {
+            if (!n || m_boundaries.empty()) return;
+            if (!std::is_sorted(data, data + n)) {
+                size_t begin = 0;
+                uint32_t bucket = find(data[0]);
+                for (size_t i = 1; i <= n; ++i) {
+                    const uint32_t next = i < n ? find(data[i]) : BUCKET_NONE;
+                    if (i < n && next == bucket) continue;
+                    if (bucket != BUCKET_NONE) {
+                        segments.insert(segments.end(), BucketSegment(bucket, begin, i));
+                    }
+                    bucket = next;
+                    begin = i;
+                }
+                return;
+            }
+            const size_t buckets = size();
+            const timestamp_t *end = data + n;
+            const timestamp_t *it = std::lower_bound(data, end, m_boundaries.front());
+            while (it != end) {
+                const uint32_t bucket = find(*it);
+                if (bucket == BUCKET_NONE) break;
+                const timestamp_t *next = std::lower_bound(it, end, m_boundaries[bucket + 1]);
+                segments.insert(segments.end(), BucketSegment(bucket, it - data, next - data));
+                it = next;
+                if (bucket + 1 >= buckets) break;
+            }
+        }
+
+        /** \brief Get the beginning of the bucket containing the timestamp
+         * \param unit      Unit of buckets
+         * \param t         Timestamp
+         * \param period    Period in seconds for BUCKET_PERIOD
+         * \return Beginning of the bucket
+         */
+        static inline timestamp_t get_bucket_start(
+                const BucketUnit unit,
+                const timestamp_t t,
+                const uint32_t period = SEC_PER_DAY) noexcept {
+            switch (unit) {
+            case BUCKET_WEEK:
+                return get_week_start_first_timestamp(t);
+            case BUCKET_MONTH:
+                return get_first_timestamp_month(t);
+            case BUCKET_QUARTER: {
+                    const uint32_t month = get_month(t);
+                    return get_timestamp(1, month - ((month - 1) % 3), get_year(t));
+                }
+            case BUCKET_YEAR:
+                return start_of_year(t);
+            default:
+                break;
+            };
+            return get_first_timestamp_period(period, t);
+        }
+
+        /** \brief Get the beginning of the next bucket
+         * \param unit      Unit of buckets
+         * \param start     Beginning of the current bucket
+         * \param period    Period in seconds for BUCKET_PERIOD
+         * \return Beginning of the next bucket
+         */
+        static inline timestamp_t get_next_bucket_start(
+                const BucketUnit unit,
+                const timestamp_t start,
+                const uint32_t period = SEC_PER_DAY) noexcept {
+            switch (unit) {
+            case BUCKET_WEEK:
+                return start + SEC_PER_WEEK;
+            case BUCKET_MONTH:
+                return start + get_num_days_month(start) * SEC_PER_DAY;
+            case BUCKET_QUARTER: {
+                    const uint32_t month = get_month(start) + 3;
+                    const uint32_t year = get_year(start);
+                    return month > MONTHS_PER_YEAR ?
+                        get_timestamp_beg_year(year + 1) :
+                        get_timestamp(1, month, year);
+                }
+            case BUCKET_YEAR:
+                return get_timestamp_beg_year(get_year(start) + 1);
+            default:
+                break;
+            };
+            return start + period;
+        }
+
+    private:
+        std::vector<timestamp_t> m_boundaries;
+    };
+
+}; // ztime
+
+#endif // ZTIME_BUCKETING_HPP_INCLUDED
@@ -0,0 +1,235 @@
+/*
+* ztime_cpp - Library for work with time.
+*
+* Copyright (c) 2018 Elektro Yar. Email: git.electroyar@gmail.com
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#pragma once
+#ifndef ZTIME_BUSINESS_CALENDAR_HPP_INCLUDED
+#define ZTIME_BUSINESS_CALENDAR_HPP_INCLUDED
+
+#include "ztime.hpp"
+#include <vector>
+#include <set>
+#include <fstream>
+
+namespace ztime {
+
+    /** \brief Business day calendar
+     *
+     * The calendar keeps a bitmap of business days indexed by the day
+     * since the beginning of UNIX time, a prefix count of business days for
+     * every 64 days (rank) and the array of business days (select).
+     * All queries are O(1) and do not iterate over days.
+     * The functions keep the time of the day of the passed timestamp.
+     */
+    class BusinessCalendar {
+    public:
+
+        BusinessCalendar() {};
+
+        /** \brief Set the weekend flag of a day of the week
+         * By default Saturday and Sunday are weekends
+         * \param weekday   Day of the week (SUN = 0, MON = 1, ... SAT = 6)
+         * \param is_day_off Weekend flag
+         */
+        inline void set_weekend(const uint32_t weekday, const bool is_day_off) noexcept {
+            if (weekday >= DAYS_PER_WEEK) return;
+            if (is_day_off) m_weekend |= (1 << weekday);
+            else m_weekend &= ~(1 << weekday);
+        }
+
+        /** \brief Add a holiday
+         * \param day   Day
+         * \param month Month
+         * \param year  Year
+         */
+        inline void add_holiday(const uint32_t day, const uint32_t month, const uint32_t year) {
+            m_holidays.insert(get_day(get_timestamp(day, month, year)));
+        }
+
+        /** \brief Add a holiday
+         * \param t Any timestamp of the day
+         */
+        inline void add_holiday(const timestamp_t t) {
+            m_holidays.insert(get_day(t));
+        }
+
+        /** \brief Load holidays from a text file
+         *
+         * The file contains one date per line in any format supported by
+         * convert_str_to_timestamp, for example 2024-12-25 or 25.12.2024.
+         * Empty lines and lines beginning with # are skipped.
+         * \param file_name Name of the file
+         * \return Returns the number of loaded holidays or -1 if the file cannot be opened
+         */
+        int load_holidays(const std::string &file_name) {
+            std::ifstream file(file_name);
+            if (!file) return -1;
+            int count = 0;
+            std::string line;
+            while (std::getline(file, line)) {
+                const size_t beg = line.find_first_not_of(" \t\r");
+                if (beg == std::string::npos || line[beg] == '#') continue;
+                const size_t end = line.find_last_not_of(" \t\r");
+                timestamp_t t = 0;
+                if (!convert_str_to_timestamp(line.substr(beg, end - beg + 1), t)) continue;
+                add_holiday(t);
+                ++count;
+            }
+            return count;
+        }
+
+        /** \brief Build the bitmap for a range of days
+         * Outside of the range only weekends are known
+         * \param start Beginning of the range
+         * \param stop  End of the range
+         * \return Returns true if the bitmap has been built
+         */
+        bool compile(const timestamp_t start, const timestamp_t stop) {
+            if (start > stop) return false;
+            m_first_day = get_day(start);
+            m_num_days = get_day(stop) - m_first_day + 1;
+
+            const size_t words = (m_num_days + 63) / 64;
+            m_bits.assign(words, 0);
+            m_rank.assign(words + 1, 0);
+            m_days.clear();
+
+            for (uint32_t i = 0; i < m_num_days; ++i) {
+                const uint32_t day = m_first_day + i;
+                if (is_weekend_day(day) || m_holidays.count(day)) continue;
+                m_bits[i >> 6] |= (uint64_t)1 << (i & 63);
+                m_days.push_back(day);
+            }
+            for (size_t w = 0; w < words; ++w) {
+                m_rank[w + 1] = m_rank[w] + (uint32_t)__builtin_popcountll(m_bits[w]);
+            }
+            return true;
+        }
+
+        /** \brief Check a business day
+         * \param t Timestamp
+         * \return Returns true if the day is a business day
+         */
+        inline bool is_business_day(const timestamp_t t) const noexcept {
+            const uint32_t day = get_day(t);
+            if (!in_range(day)) return !is_weekend_day(day);
+            const uint32_t i = day - m_first_day;
+            return (m_bits[i >> 6] >> (i & 63)) & 1;
+        }
+
+        /** \brief Add business days
+         * \param t Timestamp
+         * \param n Number of business days, may be negative
+         * \return Timestamp of the n-th business day after (or before) the day of t, or MAX_TIMESTAMP if it is outside of the range
+         */
+        inline timestamp_t add_business_days(const timestamp_t t, const int64_t n) const noexcept {
+            if (n == 0) return t;
+            const uint32_t day = get_day(t);
+            if (!in_range(day)) return MAX_TIMESTAMP;
+            const int64_t k = n > 0 ?
+                (int64_t)rank(day + 1) + n - 1 :
+                (int64_t)rank(day) + n;
+            return select(k, t);
+        }
+
+        /** \brief Get the number of business days between two dates
+         * \param a Beginning, the day of a is included
+         * \param b End, the day of b is excluded
+         * \return Number of business days, negative if b is earlier than a
+         */
+        inline int64_t business_days_between(const timestamp_t a, const timestamp_t b) const noexcept {
+            return (int64_t)rank(clamp(get_day(b))) - (int64_t)rank(clamp(get_day(a)));
+        }
+
+        /** \brief Get the next business day
+         * \param t Timestamp
+         * \return Timestamp of the first business day after the day of t, or MAX_TIMESTAMP
+         */
+        inline timestamp_t next_business_day(const timestamp_t t) const noexcept {
+            const uint32_t day = get_day(t);
+            if (!in_range(day)) return MAX_TIMESTAMP;
+            return select(rank(day + 1), t);
+        }
+
+        /** \brief Get the previous business day
+         * \param t Timestamp
+         * \return Timestamp of the last business day before the day of t, or MAX_TIMESTAMP
+         */
+        inline timestamp_t prev_business_day(const timestamp_t t) const noexcept {
+            const uint32_t day = get_day(t);
+            if (!in_range(day)) return MAX_TIMESTAMP;
+            return select((int64_t)rank(day) - 1, t);
+        }
+
+        /** \brief Get the number of business days in the compiled range
+         */
+        inline size_t size() const noexcept {
+            return m_days.size();
+        }
+
+    private:
+        std::set<uint32_t>      m_holidays;
+        uint32_t                m_weekend = (1 << SUN) | (1 << SAT);
+
+        std::vector<uint64_t>   m_bits;         /**< Bitmap of business days */
+        std::vector<uint32_t>   m_rank;         /**< Number of business days before each word of the bitmap */
+        std::vector<uint32_t>   m_days;         /**< Business days in ascending order */
+        uint32_t                m_first_day = 0;
+        uint32_t                m_num_days = 0;
+
+        inline bool is_weekend_day(const uint32_t day) const noexcept {
+            return (m_weekend >> ((day + THU) % DAYS_PER_WEEK)) & 1;
+        }
+
+        inline bool in_range(const uint32_t day) const noexcept {
+            return day >= m_first_day && (day - m_first_day) < m_num_days;
+        }
+
+        inline uint32_t clamp(const uint32_t day) const noexcept {
+            if (day < m_first_day) return m_first_day;
+            if ((day - m_first_day) > m_num_days) return m_first_day + m_num_days;
+            return day;
+        }
+
+        /** \brief Get the number of business days before the day
+         * \param day Day in the range [m_first_day, m_first_day + m_num_days]
+         */
+        inline uint32_t rank(const uint32_t day) const noexcept {
+            if (m_bits.empty()) return 0;
+            const uint32_t i = day - m_first_day;
+            const uint32_t w = i >> 6;
+            const uint32_t b = i & 63;
+            if (w >= m_bits.size()) return m_rank.back();
+            return m_rank[w] + (uint32_t)__builtin_popcountll(m_bits[w] & (((uint64_t)1 << b) - 1));
+        }
+
+        /** \brief Get the k-th business day keeping the time of the day of t
+         */
+        inline timestamp_t select(const int64_t k, const timestamp_t t) const noexcept {
+            if (k < 0 || k >= (int64_t)m_days.size()) return MAX_TIMESTAMP;
+            return get_timestamp_day(m_days[(size_t)k]) + get_second_day(t);
+        }
+    };
+
+}; // ztime
+
+#endif // ZTIME_BUSINESS_CALENDAR_HPP_INCLUDED
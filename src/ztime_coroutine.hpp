@@ -0,0 +1,516 @@
+/*
+* ztime_cpp - Library for work with time.
+*
+* Copyright (c) 2018 Elektro Yar. Email: git.electroyar@gmail.com
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#pragma once
+#ifndef ZTIME_COROUTINE_HPP_INCLUDED
+#define ZTIME_COROUTINE_HPP_INCLUDED
+
+#include "ztime.hpp"
+#include "parts/ztime_timer_service.hpp"
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <variant>
+#include <type_traits>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+
+/** \file
+ * Coroutines on top of the shared timer service (C++20).
+ *
+ * A suspended coroutine holds no thread: the service keeps a one-shot timer
+ * which resumes the coroutine. Without an executor the coroutine is resumed
+ * in the thread of the service, like a callback of a timer, so it should not
+ * block for long. With an executor it is resumed in a thread of the executor.
+ * A coroutine must not be destroyed while it waits for a timer.
+ */
+
+namespace ztime {
+
+    /** \brief Resume a coroutine in a thread of the executor
+     * \param handle    Coroutine
+     * \param executor  Executor, nullptr - the calling thread
+     */
+    inline void resume_on(std::coroutine_handle<> handle, Executor *executor) {
+        if (executor && !executor->is_inline()) {
+            executor->execute([handle] { handle.resume(); });
+        } else {
+            handle.resume();
+        }
+    }
+
+    /** \brief Coroutine which starts at once and destroys itself at the end
+     */
+    struct DetachedTask {
+        struct promise_type {
+            DetachedTask get_return_object() noexcept { return DetachedTask(); }
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_void() noexcept {}
+            void unhandled_exception() noexcept { std::terminate(); }
+        };
+    };
+
+    template<class T>
+    class Task;
+
+    /** \brief Promise of a task, keeps the continuation and the result
+     */
+    template<class T>
+    struct TaskPromiseBase {
+        std::coroutine_handle<> continuation;
+        std::exception_ptr      error;
+
+        struct FinalAwaiter {
+            bool await_ready() const noexcept { return false; }
+
+            template<class P>
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<P> handle) noexcept {
+                // the awaiting coroutine is resumed without the growth of the stack
+                std::coroutine_handle<> continuation = handle.promise().continuation;
+                if (continuation) return continuation;
+                return std::noop_coroutine();
+            }
+
+            void await_resume() const noexcept {}
+        };
+
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        FinalAwaiter final_suspend() noexcept { return {}; }
+
+        void unhandled_exception() noexcept {
+            error = std::current_exception();
+        }
+    };
+
+    template<class T>
+    struct TaskPromise : public TaskPromiseBase<T> {
+        std::optional<T> value;
+
+        Task<T> get_return_object() noexcept;
+
+        template<class U>
+        void return_value(U &&result) {
+            value.emplace(std::forward<U>(result));
+        }
+
+        T get_result() {
+            if (this->error) std::rethrow_exception(this->error);
+            return std::move(*value);
+        }
+    };
+
+    template<>
+    struct TaskPromise<void> : public TaskPromiseBase<void> {
+
+        Task<void> get_return_object() noexcept;
+
+        void return_void() noexcept {}
+
+        void get_result() {
+            if (error) std::rethrow_exception(error);
+        }
+    };
+
+    /** \brief Lazy coroutine task
+     * The task starts when it is awaited (co_await) or passed to sync_wait(), spawn()
+     * or with_timeout(). The awaiting coroutine is resumed in the thread which
+     * finished the task.
+     */
+    template<class T = void>
+    class Task {
+    public:
+        typedef TaskPromise<T> promise_type;
+        typedef std::coroutine_handle<promise_type> handle_t;
+
+        Task() noexcept {};
+
+        explicit Task(handle_t handle) noexcept : m_handle(handle) {};
+
+        Task(Task &&other) noexcept : m_handle(other.m_handle) {
+            other.m_handle = nullptr;
+        }
+
+        Task &operator=(Task &&other) noexcept {
+            if (this == &other) return *this;
+            if (m_handle) m_handle.destroy();
+            m_handle = other.m_handle;
+            other.m_handle = nullptr;
+            return *this;
+        }
+
+        Task(const Task &) = delete;
+        Task &operator=(const Task &) = delete;
+
+        ~Task() {
+            if (m_handle) m_handle.destroy();
+        }
+
+        bool await_ready() const noexcept {
+            return !m_handle || m_handle.done();
+        }
+
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> continuation) noexcept {
+            m_handle.promise().continuation = continuation;
+            return m_handle;
+        }
+
+        T await_resume() {
+            return m_handle.promise().get_result();
+        }
+
+    private:
+        handle_t m_handle = nullptr;
+    };
+
+    template<class T>
+    inline Task<T> TaskPromise<T>::get_return_object() noexcept {
+        return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+    }
+
+    inline Task<void> TaskPromise<void>::get_return_object() noexcept {
+        return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+    }
+
+    /** \brief Start the task without waiting for it
+     * The task runs in the calling thread until its first suspension.
+     * An exception of the task calls std::terminate().
+     * \param task Task
+     */
+    inline DetachedTask spawn(Task<void> task) {
+        co_await task;
+    }
+
+    /** \brief State of sync_wait()
+     */
+    template<class T>
+    struct SyncWaitState {
+        typedef std::conditional_t<std::is_void_v<T>, std::monostate, T> value_t;
+
+        std::mutex              mutex;
+        std::condition_variable cv;
+        bool                    is_done = false;
+        std::optional<value_t>  value;
+        std::exception_ptr      error;
+    };
+
+    template<class T>
+    DetachedTask run_sync_wait(Task<T> &task, SyncWaitState<T> &state) {
+        try {
+            if constexpr (std::is_void_v<T>) {
+                co_await task;
+                state.value.emplace();
+            } else {
+                state.value.emplace(co_await task);
+            }
+        } catch (...) {
+            state.error = std::current_exception();
+        }
+        std::lock_guard<std::mutex> lock(state.mutex);
+        state.is_done = true;
+        state.cv.notify_one();
+    }
+
+    /** \brief Run the task and block the calling thread until the task is done
+     * \param task Task
+     * \return Result of the task, an exception of the task is rethrown
+     */
+    template<class T>
+    T sync_wait(Task<T> task) {
+        SyncWaitState<T> state;
+        run_sync_wait(task, state);
+        std::unique_lock<std::mutex> lock(state.mutex);
+        state.cv.wait(lock, [&state] { return state.is_done; });
+        if (state.error) std::rethrow_exception(state.error);
+        if constexpr (!std::is_void_v<T>) return std::move(*state.value);
+    }
+
+    /** \brief Awaitable of a delay on the shared timer service
+     */
+    class SleepAwaiter {
+    public:
+
+        SleepAwaiter(const uint64_t delay_ns, std::shared_ptr<Executor> executor) noexcept :
+            m_delay_ns(delay_ns), m_executor(std::move(executor)) {};
+
+        bool await_ready() const noexcept {
+            return m_delay_ns == 0;
+        }
+
+        void await_suspend(std::coroutine_handle<> handle) {
+            std::shared_ptr<Executor> executor = m_executor;
+            // the callback may resume the coroutine before add() returns
+            TimerService::get_shared().add([handle, executor]() -> uint64_t {
+                resume_on(handle, executor.get());
+                return 0;
+            }, m_delay_ns, FIXED_DELAY);
+        }
+
+        void await_resume() const noexcept {}
+
+    private:
+        uint64_t                    m_delay_ns = 0;
+        std::shared_ptr<Executor>   m_executor;
+    };
+
+    /** \brief Suspend the coroutine for the duration
+     * \param duration  Delay
+     * \param executor  Executor of the coroutine, nullptr - the thread of the timer service
+     */
+    template<class Rep, class Period>
+    inline SleepAwaiter sleep_for(
+            const std::chrono::duration<Rep, Period> duration,
+            std::shared_ptr<Executor> executor = nullptr) noexcept {
+        const int64_t delay = std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+        return SleepAwaiter(delay > 0 ? (uint64_t)delay : 0, std::move(executor));
+    }
+
+    /** \brief Suspend the coroutine until the time point of a std::chrono clock
+     * \param time_point    Time point
+     * \param executor      Executor of the coroutine, nullptr - the thread of the timer service
+     */
+    template<class Clock, class Duration>
+    inline SleepAwaiter sleep_until(
+            const std::chrono::time_point<Clock, Duration> time_point,
+            std::shared_ptr<Executor> executor = nullptr) noexcept {
+        return sleep_for(time_point - Clock::now(), std::move(executor));
+    }
+
+    /** \brief Suspend the coroutine until the timestamp
+     * The delay is calculated once, a step of the wall clock does not move the wake-up.
+     * \param timestamp Timestamp in seconds, with fractions of a second
+     * \param executor  Executor of the coroutine, nullptr - the thread of the timer service
+     */
+    inline SleepAwaiter sleep_until(
+            const ftimestamp_t timestamp,
+            std::shared_ptr<Executor> executor = nullptr) noexcept {
+        const ftimestamp_t delay = timestamp - get_ftimestamp();
+        return SleepAwaiter(delay > 0 ? (uint64_t)(delay * (ftimestamp_t)NS_PER_SEC) : 0,
+            std::move(executor));
+    }
+
+    /** \brief State of with_timeout(), shared by the task and the timer
+     */
+    template<class T>
+    struct TimeoutState {
+        typedef std::conditional_t<std::is_void_v<T>, std::monostate, T> value_t;
+
+        std::atomic<bool>           is_done = ATOMIC_VAR_INIT(false);
+        bool                        is_timeout = false;
+        std::optional<value_t>      value;
+        std::exception_ptr          error;
+        std::coroutine_handle<>     continuation;
+        std::shared_ptr<Executor>   executor;
+        uint64_t                    timer_id = 0;
+    };
+
+    template<class T>
+    DetachedTask run_with_timeout(Task<T> task, std::shared_ptr<TimeoutState<T>> state) {
+        std::optional<typename TimeoutState<T>::value_t> value;
+        std::exception_ptr error;
+        try {
+            if constexpr (std::is_void_v<T>) {
+                co_await task;
+                value.emplace();
+            } else {
+                value.emplace(co_await task);
+            }
+        } catch (...) {
+            error = std::current_exception();
+        }
+        // the result of a task which lost the race is dropped
+        if (state->is_done.exchange(true)) co_return;
+        TimerService::get_shared().cancel(state->timer_id);
+        state->value = std::move(value);
+        state->error = error;
+        resume_on(state->continuation, state->executor.get());
+    }
+
+    /** \brief Awaitable of a task with a timeout
+     */
+    template<class T>
+    class TimeoutAwaiter {
+    public:
+        typedef std::conditional_t<std::is_void_v<T>, bool, std::optional<T>> result_t;
+
+        TimeoutAwaiter(Task<T> task, const uint64_t timeout_ns, std::shared_ptr<Executor> executor) :
+                m_task(std::move(task)),
+                m_state(std::make_shared<TimeoutState<T>>()),
+                m_timeout_ns(timeout_ns) {
+            m_state->executor = std::move(executor);
+        };
+
+        bool await_ready() const noexcept {
+            return false;
+        }
+
+        void await_suspend(std::coroutine_handle<> handle) {
+            // the coroutine may be resumed and the awaiter destroyed before the return
+            Task<T> task = std::move(m_task);
+            std::shared_ptr<TimeoutState<T>> state = m_state;
+            state->continuation = handle;
+            state->timer_id = TimerService::get_shared().add([state]() -> uint64_t {
+                if (!state->is_done.exchange(true)) {
+                    state->is_timeout = true;
+                    resume_on(state->continuation, state->executor.get());
+                }
+                return 0;
+            }, m_timeout_ns, FIXED_DELAY);
+            run_with_timeout(std::move(task), std::move(state));
+        }
+
+        result_t await_resume() {
+            if (m_state->error) std::rethrow_exception(m_state->error);
+            if constexpr (std::is_void_v<T>) {
+                return !m_state->is_timeout;
+            } else {
+                if (m_state->is_timeout) return std::nullopt;
+                return std::move(*m_state->value);
+            }
+        }
+
+    private:
+        Task<T>                             m_task;
+        std::shared_ptr<TimeoutState<T>>    m_state;
+        uint64_t                            m_timeout_ns = 0;
+    };
+
+    /** \brief Await the task for no longer than the timeout
+     * The task is not cancelled by the timeout, it runs to the end and its result is dropped.
+     * \param task      Task
+     * \param timeout   Timeout
+     * \param executor  Executor of the coroutine, nullptr - the thread which finished first
+     * \return std::optional with the result, or std::nullopt after the timeout.
+     * For Task<void> returns false after the timeout
+     */
+    template<class T, class Rep, class Period>
+    inline TimeoutAwaiter<T> with_timeout(
+            Task<T> task,
+            const std::chrono::duration<Rep, Period> timeout,
+            std::shared_ptr<Executor> executor = nullptr) {
+        const int64_t delay = std::chrono::duration_cast<std::chrono::nanoseconds>(timeout).count();
+        return TimeoutAwaiter<T>(std::move(task), delay > 0 ? (uint64_t)delay : 0, std::move(executor));
+    }
+
+    /** \brief Periodic ticks for coroutines
+     *
+     * The ticker is a FIXED_RATE timer of the shared timer service. co_await next()
+     * returns the number of ticks since the previous call, more than 1 means
+     * that the coroutine missed ticks. Ticks are counted while no coroutine waits.
+     * Only one coroutine may wait for the ticker at once, and the ticker must not
+     * be destroyed while a coroutine waits for it.
+     */
+    class Ticker {
+    private:
+
+        struct State {
+            std::mutex                  mutex;
+            uint64_t                    ticks = 0;
+            uint64_t                    result = 0;
+            std::coroutine_handle<>     waiter;
+            std::shared_ptr<Executor>   executor;
+        };
+
+    public:
+
+        class Awaiter {
+        public:
+
+            explicit Awaiter(std::shared_ptr<State> state) noexcept : m_state(std::move(state)) {};
+
+            bool await_ready() const noexcept {
+                return false;
+            }
+
+            bool await_suspend(std::coroutine_handle<> handle) {
+                std::lock_guard<std::mutex> lock(m_state->mutex);
+                if (m_state->ticks) {
+                    m_state->result = m_state->ticks;
+                    m_state->ticks = 0;
+                    return false;
+                }
+                m_state->waiter = handle;
+                return true;
+            }
+
+            uint64_t await_resume() const noexcept {
+                return m_state->result;
+            }
+
+        private:
+            std::shared_ptr<State> m_state;
+        };
+
+        /** \brief Start the ticker
+         * \param period    Period of ticks
+         * \param executor  Executor of the coroutine, nullptr - the thread of the timer service
+         */
+        template<class Rep, class Period>
+        explicit Ticker(
+                const std::chrono::duration<Rep, Period> period,
+                std::shared_ptr<Executor> executor = nullptr) :
+                m_state(std::make_shared<State>()) {
+            m_state->executor = std::move(executor);
+            const uint64_t period_ns = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(period).count();
+            std::shared_ptr<State> state = m_state;
+            m_id = TimerService::get_shared().add([state, period_ns]() -> uint64_t {
+                std::coroutine_handle<> waiter;
+                {
+                    std::lock_guard<std::mutex> lock(state->mutex);
+                    ++state->ticks;
+                    if (!state->waiter) return period_ns;
+                    waiter = state->waiter;
+                    state->waiter = nullptr;
+                    state->result = state->ticks;
+                    state->ticks = 0;
+                }
+                resume_on(waiter, state->executor.get());
+                return period_ns;
+            }, period_ns ? period_ns : 1, FIXED_RATE);
+        }
+
+        Ticker(const Ticker &) = delete;
+        Ticker &operator=(const Ticker &) = delete;
+
+        ~Ticker() {
+            TimerService::get_shared().remove(m_id);
+        }
+
+        /** \brief Wait for the next tick
+         * \return Awaitable, co_await returns the number of ticks since the previous call
+         */
+        inline Awaiter next() const noexcept {
+            return Awaiter(m_state);
+        }
+
+    private:
+        std::shared_ptr<State>  m_state;
+        uint64_t                m_id = 0;
+    };
+
+}; // ztime
+
+#endif // ZTIME_COROUTINE_HPP_INCLUDED
@@ -0,0 +1,708 @@
+/*
+* ztime_cpp - Library for work with time.
+*
+* Copyright (c) 2018 Elektro Yar. Email: git.electroyar@gmail.com
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#pragma once
+#ifndef ZTIME_CRON_HPP_INCLUDED
+#define ZTIME_CRON_HPP_INCLUDED
+
+#include "ztime.hpp"
+#include "parts/ztime_timer_queue.hpp"
+#include "parts/ztime_slot_map.hpp"
+#include <string>
+#include <vector>
+#include <memory>
+#include <cctype>
+
+#if defined(__linux__)
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+namespace ztime {
+
+    /** \brief Cron expression
+     *
+     * Fields: [second] minute hour day-of-month month day-of-week.
+     * With five fields the second is 0. A field is a list of items separated
+     * by commas: N, A-B, * or ?, an item may have a step /S (0-30/5, 10/15).
+     * Months and days of the week
+     * may be given by names (JAN, MON), Sunday is 0 or 7.
+     * Calendar rules: L in the day of month is the last day of the month,
+     * NL in the day of the week is the last weekday N of the month (0L - the last
+     * Sunday), N#K is the K-th weekday N of the month (1#1 - the first Monday).
+     * Macros: @yearly, @annually, @monthly, @weekly, @daily, @midnight, @hourly.
+     * If both the day of month and the day of the week are restricted,
+     * a day matches either of them, like in Vixie cron.
+     *
+     * The next time is calculated field by field over bitmasks of allowed values,
+     * a field costs one scan of a bitmask and there is no search second by second.
+     */
+    class CronExpression {
+    public:
+
+        CronExpression() {};
+
+        CronExpression(const std::string &expression) {
+            parse(expression);
+        }
+
+        /** \brief Parse the expression
+         * \param expression Cron expression
+         * \return Returns false if the expression is not correct
+         */
+        bool parse(const std::string &expression) {
+            *this = CronExpression();
+            std::string value = expression;
+            if (!value.empty() && value[0] == '@') {
+                value = get_macro(value);
+                if (value.empty()) return false;
+            }
+            std::vector<std::string> fields = split(value, ' ');
+            if (fields.size() == 5) fields.insert(fields.begin(), "0");
+            if (fields.size() != 6) return false;
+
+            uint64_t mask = 0;
+            if (!parse_field(fields[0], 0, 59, nullptr, mask)) return false;
+            m_seconds = mask;
+            if (!parse_field(fields[1], 0, 59, nullptr, mask)) return false;
+            m_minutes = mask;
+            if (!parse_field(fields[2], 0, 23, nullptr, mask)) return false;
+            m_hours = (uint32_t)mask;
+            if (!parse_field(fields[4], 1, 12, MonthNameShort, mask)) return false;
+            m_months = (uint16_t)mask;
+            if (!parse_days(fields[3])) return false;
+            if (!parse_weekdays(fields[5])) return false;
+            m_is_valid = true;
+            return true;
+        }
+
+        inline bool is_valid() const noexcept {
+            return m_is_valid;
+        }
+
+        /** \brief Check that the time matches the expression
+         * \param t Timestamp
+         */
+        inline bool match(const timestamp_t t) const {
+            if (!m_is_valid) return false;
+            const uint32_t year = get_year(t);
+            const uint32_t month = get_month(t);
+            return  (m_months >> month & 1) &&
+                    (get_day_mask(month, year) >> get_day_month(t) & 1) &&
+                    (m_hours >> get_hour_day(t) & 1) &&
+                    (m_minutes >> get_minute_hour(t) & 1) &&
+                    (m_seconds >> get_second_minute(t) & 1);
+        }
+
+        /** \brief Get the next time matching the expression
+         * \param t Timestamp
+         * \return The first matching time after t or NO_TIME
+         */
+        timestamp_t next(const timestamp_t t) const {
+            if (!m_is_valid) return NO_TIME;
+            const timestamp_t start = t + 1;
+            uint32_t year = get_year(start);
+            uint32_t month = get_month(start);
+            uint32_t day = get_day_month(start);
+            uint32_t hour = get_hour_day(start);
+            uint32_t minute = get_minute_hour(start);
+            uint32_t second = get_second_minute(start);
+            const uint32_t max_year = year + MAX_YEARS;
+            while (year <= max_year) {
+                uint32_t value = 0;
+                if (!find_next(m_months, month, value)) {
+                    ++year;
+                    month = 1;
+                    day = 1;
+                    hour = minute = second = 0;
+                    continue;
+                }
+                if (value != month) {
+                    month = value;
+                    day = 1;
+                    hour = minute = second = 0;
+                }
+                if (!find_next(get_day_mask(month, year), day, value)) {
+                    next_month(month, year);
+                    day = 1;
+                    hour = minute = second = 0;
+                    continue;
+                }
+                if (value != day) {
+                    day = value;
+                    hour = minute = second = 0;
+                }
+                if (!find_next(m_hours, hour, value)) {
+                    next_day(day, month, year);
+                    hour = minute = second = 0;
+                    continue;
+                }
+                if (value != hour) {
+                    hour = value;
+                    minute = second = 0;
+                }
+                if (!find_next(m_minutes, minute, value)) {
+                    next_hour(hour, day, month, year);
+                    minute = second = 0;
+                    continue;
+                }
+                if (value != minute) {
+                    minute = value;
+                    second = 0;
+                }
+                if (!find_next(m_seconds, second, value)) {
+                    next_minute(minute, hour, day, month, year);
+                    second = 0;
+                    continue;
+                }
+                return get_timestamp(day, month, year, hour, minute, value);
+            }
+            return NO_TIME;
+        }
+
+        /** \brief Get the next time matching the expression in the time zone
+         * The expression is evaluated in the local time of the zone.
+         * A local time which is repeated by the change to winter time fires once.
+         * \param gmt   Timestamp, GMT time
+         * \param zone  Time zone (GMT, CET, EET, MSK)
+         * \return The first matching GMT time after gmt or NO_TIME
+         */
+        timestamp_t next(const timestamp_t gmt, const TimeZone zone) const {
+            if (zone == GMT) return next(gmt);
+            timestamp_t local = convert_gmt_to_zone(gmt, zone);
+            for (size_t i = 0; i < 4; ++i) {
+                local = next(local);
+                if (local == NO_TIME) return NO_TIME;
+                const timestamp_t t = convert_zone_to_gmt(local, zone);
+                if (t > gmt) return t;
+            }
+            return NO_TIME;
+        }
+
+        static const timestamp_t NO_TIME = 0;   /**< The expression never matches */
+        static const uint32_t MAX_YEARS = 400;  /**< Range of the search, the calendar repeats every 400 years */
+
+    private:
+        uint64_t    m_seconds = 0;              /**< Bits 0..59 */
+        uint64_t    m_minutes = 0;              /**< Bits 0..59 */
+        uint32_t    m_hours = 0;                /**< Bits 0..23 */
+        uint32_t    m_days = 0;                 /**< Bits 1..31 */
+        uint16_t    m_months = 0;               /**< Bits 1..12 */
+        uint8_t     m_weekdays = 0;             /**< Bits 0..6, SUN = 0 */
+        uint8_t     m_last_weekdays = 0;        /**< NL, bits 0..6 */
+        uint8_t     m_nth_weekdays[5] = {0};    /**< N#K, bits 0..6 for K = 1..5 */
+        bool        m_is_last_day = false;      /**< L in the day of month */
+        bool        m_is_any_day = true;        /**< The day of month is * or ? */
+        bool        m_is_any_weekday = true;    /**< The day of the week is * or ? */
+        bool        m_is_valid = false;
+
+        /** \brief Find the lowest set bit not less than from
+         */
+        static inline bool find_next(const uint64_t mask, const uint32_t from, uint32_t &value) noexcept {
+            if (from >= 64) return false;
+            const uint64_t rest = mask & (~0ULL << from);
+            if (!rest) return false;
+            value = (uint32_t)__builtin_ctzll(rest);
+            return true;
+        }
+
+        static inline void next_month(uint32_t &month, uint32_t &year) noexcept {
+            if (++month > MONTHS_PER_YEAR) {
+                month = 1;
+                ++year;
+            }
+        }
+
+        static inline void next_day(uint32_t &day, uint32_t &month, uint32_t &year) {
+            if (++day > get_num_days_month(month, year)) {
+                day = 1;
+                next_month(month, year);
+            }
+        }
+
+        static inline void next_hour(uint32_t &hour, uint32_t &day, uint32_t &month, uint32_t &year) {
+            if (++hour >= HOURS_PER_DAY) {
+                hour = 0;
+                next_day(day, month, year);
+            }
+        }
+
+        static inline void next_minute(uint32_t &minute, uint32_t &hour, uint32_t &day, uint32_t &month, uint32_t &year) {
+            if (++minute >= MIN_PER_HOUR) {
+                minute = 0;
+                next_hour(hour, day, month, year);
+            }
+        }
+
+        /** \brief Get the mask of the days of the month which match the expression
+         * \return Bits 1..31
+         */
+        uint32_t get_day_mask(const uint32_t month, const uint32_t year) const {
+            const uint32_t num_days = get_num_days_month(month, year);
+            const uint32_t month_mask = (uint32_t)(((1ULL << (num_days + 1)) - 1) & ~1ULL);
+            uint32_t days = m_days;
+            if (m_is_last_day) days |= 1UL << num_days;
+
+            // the weekdays are rotated to the weekday of the first day and repeated by weeks
+            const uint32_t first = get_weekday(1, month, year);
+            uint32_t weekdays = 0;
+            if (m_weekdays) {
+                uint32_t week = 0;
+                for (uint32_t i = 0; i < DAYS_PER_WEEK; ++i) {
+                    if (m_weekdays >> ((first + i) % DAYS_PER_WEEK) & 1) week |= 1UL << i;
+                }
+                const uint64_t pattern = (uint64_t)week | (uint64_t)week << 7 | (uint64_t)week << 14 |
+                    (uint64_t)week << 21 | (uint64_t)week << 28;
+                weekdays = (uint32_t)(pattern << 1);
+            }
+            if (m_last_weekdays) {
+                const uint32_t last = (first + num_days - 1) % DAYS_PER_WEEK;
+                for (uint32_t w = 0; w < DAYS_PER_WEEK; ++w) {
+                    if (!(m_last_weekdays >> w & 1)) continue;
+                    weekdays |= 1UL << (num_days - (last + DAYS_PER_WEEK - w) % DAYS_PER_WEEK);
+                }
+            }
+            for (uint32_t k = 0; k < 5; ++k) {
+                if (!m_nth_weekdays[k]) continue;
+                for (uint32_t w = 0; w < DAYS_PER_WEEK; ++w) {
+                    if (!(m_nth_weekdays[k] >> w & 1)) continue;
+                    const uint32_t day = 1 + (w + DAYS_PER_WEEK - first) % DAYS_PER_WEEK + DAYS_PER_WEEK * k;
+                    if (day <= num_days) weekdays |= 1UL << day;
+                }
+            }
+
+            uint32_t mask = 0;
+            if (m_is_any_day && m_is_any_weekday) mask = month_mask;
+            else if (m_is_any_day) mask = weekdays;
+            else if (m_is_any_weekday) mask = days;
+            else mask = days | weekdays;
+            return mask & month_mask;
+        }
+
+        static inline std::string get_macro(std::string value) {
+            std::transform(value.begin(), value.end(), value.begin(), ::tolower);
+            if (value == "@yearly" || value == "@annually") return "0 0 1 1 *";
+            if (value == "@monthly") return "0 0 1 * *";
+            if (value == "@weekly") return "0 0 * * 0";
+            if (value == "@daily" || value == "@midnight") return "0 0 * * *";
+            if (value == "@hourly") return "0 * * * *";
+            return std::string();
+        }
+
+        static inline std::vector<std::string> split(const std::string &value, const char separator) {
+            std::vector<std::string> items;
+            std::string item;
+            for (size_t i = 0; i <= value.size(); ++i) {
+                const char c = i < value.size() ? value[i] : separator;
+                const bool is_separator = separator == ' ' ? (c == ' ' || c == '\t') : c == separator;
+                if (!is_separator) {
+                    item += c;
+                    continue;
+                }
+                if (!item.empty() || separator != ' ') items.push_back(item);
+                item.clear();
+            }
+            return items;
+        }
+
+        /** \brief Parse a number or a name
+         * \param names Short names of the values starting from min_value, or nullptr
+         */
+        static inline bool parse_value(
+                const std::string &str,
+                const uint32_t min_value,
+                const char* const *names,
+                const size_t num_names,
+                uint32_t &value) {
+            if (str.empty()) return false;
+            if (std::isdigit((unsigned char)str[0])) {
+                value = 0;
+                for (size_t i = 0; i < str.size(); ++i) {
+                    if (!std::isdigit((unsigned char)str[i]) || value > 1000) return false;
+                    value = value * 10 + (str[i] - '0');
+                }
+                return true;
+            }
+            if (!names) return false;
+            for (size_t i = 0; i < num_names; ++i) {
+                const std::string name(names[i]);
+                if (str.size() != name.size()) continue;
+                bool is_equal = true;
+                for (size_t j = 0; j < str.size(); ++j) {
+                    if (std::tolower((unsigned char)str[j]) != std::tolower((unsigned char)name[j])) is_equal = false;
+                }
+                if (is_equal) {
+                    value = min_value + (uint32_t)i;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /** \brief Parse a field into a mask of bits min_value..max_value
+         */
+        static bool parse_field(
+                const std::string &field,
+                const uint32_t min_value,
+                const uint32_t max_value,
+                const char* const *names,
+                uint64_t &mask,
+                const size_t num_names = MONTHS_PER_YEAR) {
+            mask = 0;
+            const std::vector<std::string> items = split(field, ',');
+            if (items.empty()) return false;
+            for (size_t i = 0; i < items.size(); ++i) {
+                std::string range = items[i];
+                uint32_t step = 1;
+                const size_t slash = range.find('/');
+                if (slash != std::string::npos) {
+                    if (!parse_value(range.substr(slash + 1), 0, nullptr, 0, step) || !step) return false;
+                    range = range.substr(0, slash);
+                }
+                uint32_t first = min_value;
+                uint32_t last = max_value;
+                if (range != "*" && range != "?") {
+                    const size_t dash = range.find('-');
+                    if (!parse_value(range.substr(0, dash), min_value, names, num_names, first)) return false;
+                    if (dash != std::string::npos) {
+                        if (!parse_value(range.substr(dash + 1), min_value, names, num_names, last)) return false;
+                    } else if (slash == std::string::npos) {
+                        last = first;
+                    }
+                }
+                if (first < min_value || last > max_value || first > last) return false;
+                for (uint32_t v = first; v <= last; v += step) {
+                    mask |= 1ULL << v;
+                }
+            }
+            return true;
+        }
+
+        bool parse_days(const std::string &field) {
+            m_is_any_day = field == "*" || field == "?";
+            std::string rest;
+            const std::vector<std::string> items = split(field, ',');
+            for (size_t i = 0; i < items.size(); ++i) {
+                if (items[i] == "L" || items[i] == "l") {
+                    m_is_last_day = true;
+                    continue;
+                }
+                rest += rest.empty() ? items[i] : "," + items[i];
+            }
+            if (rest.empty()) return m_is_last_day;
+            uint64_t mask = 0;
+            if (!parse_field(rest, 1, 31, nullptr, mask)) return false;
+            m_days = (uint32_t)mask;
+            return true;
+        }
+
+        bool parse_weekdays(const std::string &field) {
+            m_is_any_weekday = field == "*" || field == "?";
+            std::string rest;
+            const std::vector<std::string> items = split(field, ',');
+            for (size_t i = 0; i < items.size(); ++i) {
+                const std::string &item = items[i];
+                const size_t hash = item.find('#');
+                uint32_t weekday = 0;
+                if (item.size() > 1 && (item.back() == 'L' || item.back() == 'l')) {
+                    if (!parse_value(item.substr(0, item.size() - 1), 0, WeekdayNameShort, DAYS_PER_WEEK, weekday) ||
+                        weekday > DAYS_PER_WEEK) return false;
+                    m_last_weekdays |= 1 << (weekday % DAYS_PER_WEEK);
+                    continue;
+                }
+                if (hash != std::string::npos) {
+                    uint32_t nth = 0;
+                    if (!parse_value(item.substr(0, hash), 0, WeekdayNameShort, DAYS_PER_WEEK, weekday) ||
+                        weekday > DAYS_PER_WEEK) return false;
+                    if (!parse_value(item.substr(hash + 1), 0, nullptr, 0, nth) || nth < 1 || nth > 5) return false;
+                    m_nth_weekdays[nth - 1] |= 1 << (weekday % DAYS_PER_WEEK);
+                    continue;
+                }
+                rest += rest.empty() ? item : "," + item;
+            }
+            if (rest.empty()) return m_last_weekdays || m_nth_weekdays[0] || m_nth_weekdays[1] ||
+                m_nth_weekdays[2] || m_nth_weekdays[3] || m_nth_weekdays[4];
+            uint64_t mask = 0;
+            // 7 is Sunday too
+            if (!parse_field(rest, 0, 7, WeekdayNameShort, mask, DAYS_PER_WEEK)) return false;
+            if (mask >> 7 & 1) mask |= 1;
+            m_weekdays = (uint8_t)(mask & 0x7F);
+            return true;
+        }
+    };
+
+    /** \brief Scheduler of jobs by cron expressions
+     *
+     * Jobs are kept in a heap ordered by the next time of the wall clock.
+     * The thread of the scheduler sleeps until the absolute time of the nearest job.
+     * On Linux the thread sleeps on a timerfd of CLOCK_REALTIME which is cancelled
+     * when the wall clock is set, on other systems the thread checks the clock
+     * at least once per second. When the wall clock steps, the next times of
+     * all jobs are calculated again: a step back does not delay the jobs,
+     * a step forward fires the missed jobs once.
+     * Callbacks are called in the thread of the scheduler, one at a time.
+     */
+    class CronScheduler {
+    public:
+        typedef std::function<void()> callback_t;
+
+        CronScheduler() {
+#           if defined(__linux__)
+            m_timer_fd = timerfd_create(CLOCK_REALTIME, TFD_NONBLOCK | TFD_CLOEXEC);
+            m_event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+#           endif
+            m_offset = get_clock_offset();
+            m_thread = std::thread([this] {
+                work();
+            });
+        }
+
+        CronScheduler(const CronScheduler &) = delete;
+        CronScheduler &operator=(const CronScheduler &) = delete;
+
+        ~CronScheduler() {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_shutdown = true;
+            }
+            wake_up();
+            if (m_thread.get_id() == std::this_thread::get_id()) m_thread.detach();
+            else m_thread.join();
+#           if defined(__linux__)
+            if (m_timer_fd >= 0) close(m_timer_fd);
+            if (m_event_fd >= 0) close(m_event_fd);
+#           endif
+        }
+
+        /** \brief Add a job
+         * \param expression    Cron expression
+         * \param callback      Callback function
+         * \param zone          Time zone of the expression
+         * \return Id of the job or 0 if the expression is not correct or never matches
+         */
+        uint64_t add(
+                const CronExpression &expression,
+                callback_t callback,
+                const TimeZone zone = GMT) {
+            if (!expression.is_valid() || !callback) return 0;
+            std::unique_ptr<Job> job(new Job());
+            job->expression = expression;
+            job->zone = zone;
+            job->callback = std::move(callback);
+            job->next = expression.next(get_timestamp(), zone);
+            if (job->next == CronExpression::NO_TIME) return 0;
+            job->deadline = job->next * NS_PER_SEC;
+            uint64_t id = 0;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                Job *ptr = job.get();
+                id = m_jobs.insert(std::move(job));
+                ptr->id = id;
+                m_queue.push(ptr);
+            }
+            wake_up();
+            return id;
+        }
+
+        uint64_t add(
+                const std::string &expression,
+                callback_t callback,
+                const TimeZone zone = GMT) {
+            return add(CronExpression(expression), std::move(callback), zone);
+        }
+
+        /** \brief Remove the job
+         * Waits for the running callback of the job, unless it is called from a callback
+         * \param id Id of the job
+         */
+        void remove(const uint64_t id) {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            std::unique_ptr<Job> *job = m_jobs.get(id);
+            if (!job) return;
+            m_queue.erase(job->get());
+            if (std::this_thread::get_id() != m_thread.get_id()) {
+                m_done_cv.wait(lock, [this, id] {
+                    return m_running != id;
+                });
+            }
+            // the callback of the running job is kept until it returns
+            if (m_running == id) m_removed = std::move(*job);
+            m_jobs.erase(id);
+        }
+
+        /** \brief Get the next time of the job
+         * \param id Id of the job
+         * \return GMT time or CronExpression::NO_TIME
+         */
+        timestamp_t get_next(const uint64_t id) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            const std::unique_ptr<Job> *job = m_jobs.get(id);
+            if (!job) return CronExpression::NO_TIME;
+            return (*job)->next;
+        }
+
+        size_t size() {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_jobs.size();
+        }
+
+    private:
+        static const uint64_t NS_PER_SEC = 1000000000ULL;
+
+        struct Job : public TimerNode {
+            CronExpression  expression;
+            TimeZone        zone = GMT;
+            callback_t      callback;
+            uint64_t        id = 0;
+            timestamp_t     next = 0;       /**< Next time, GMT */
+        };
+
+        SlotMap<std::unique_ptr<Job>>   m_jobs;
+        TimerHeap                       m_queue;        /**< Jobs by the time of the wall clock, ns */
+        std::unique_ptr<Job>            m_removed;      /**< Job removed by its own callback */
+        std::mutex                      m_mutex;
+        std::condition_variable         m_cv;
+        std::condition_variable         m_done_cv;
+        uint64_t                        m_running = 0;  /**< Id of the job whose callback is running */
+        int64_t                         m_offset = 0;   /**< Wall clock minus monotonic clock, ns */
+        bool                            m_shutdown = false;
+        int                             m_timer_fd = -1;
+        int                             m_event_fd = -1;
+        std::thread                     m_thread;
+
+        static inline uint64_t get_wall_ns() noexcept {
+            return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+        }
+
+        static inline int64_t get_clock_offset() noexcept {
+            return (int64_t)get_wall_ns() - (int64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        inline void wake_up() {
+#           if defined(__linux__)
+            if (m_event_fd >= 0) {
+                const uint64_t value = 1;
+                if (write(m_event_fd, &value, sizeof(value)) < 0) {};
+                return;
+            }
+#           endif
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_cv.notify_one();
+        }
+
+        /** \brief Calculate the next times of all jobs after a step of the wall clock
+         */
+        void rearm(const timestamp_t now) {
+            m_jobs.for_each([this, now](const uint64_t, std::unique_ptr<Job> &job) {
+                if (job.get()->is_queued && job->deadline <= now * NS_PER_SEC) return;
+                const timestamp_t next = job->expression.next(now, job->zone);
+                job->next = next;
+                if (next == CronExpression::NO_TIME) {
+                    m_queue.erase(job.get());
+                    return;
+                }
+                job->deadline = next * NS_PER_SEC;
+                m_queue.update(job.get());
+            });
+        }
+
+        /** \brief Sleep until the time of the wall clock or until a wake-up
+         * \return Returns true if the wall clock has been set
+         */
+        bool sleep_until(std::unique_lock<std::mutex> &lock, const uint64_t deadline) {
+#           if defined(__linux__)
+            if (m_timer_fd >= 0 && m_event_fd >= 0) {
+                struct itimerspec spec = {};
+                if (deadline != TimerQueue::NO_DEADLINE) {
+                    spec.it_value.tv_sec = (time_t)(deadline / NS_PER_SEC);
+                    spec.it_value.tv_nsec = (long)(deadline % NS_PER_SEC);
+                    if (!spec.it_value.tv_sec && !spec.it_value.tv_nsec) spec.it_value.tv_nsec = 1;
+                }
+                timerfd_settime(m_timer_fd, TFD_TIMER_ABSTIME | TFD_TIMER_CANCEL_ON_SET, &spec, nullptr);
+                lock.unlock();
+                struct pollfd fds[2] = {
+                    {m_event_fd, POLLIN, 0},
+                    {m_timer_fd, POLLIN, 0}
+                };
+                bool is_clock_set = false;
+                if (poll(fds, 2, -1) > 0) {
+                    uint64_t value = 0;
+                    if (fds[0].revents & POLLIN) {
+                        if (read(m_event_fd, &value, sizeof(value)) < 0) {};
+                    }
+                    if (fds[1].revents & POLLIN) {
+                        if (read(m_timer_fd, &value, sizeof(value)) < 0 && errno == ECANCELED) is_clock_set = true;
+                    }
+                }
+                lock.lock();
+                return is_clock_set;
+            }
+#           endif
+            // without the notification the clock is checked at least once per second
+            const uint64_t now = get_wall_ns();
+            const uint64_t timeout = deadline > now ? std::min<uint64_t>(deadline - now, (uint64_t)NS_PER_SEC) : 0;
+            m_cv.wait_for(lock, std::chrono::nanoseconds(timeout));
+            return false;
+        }
+
+        void work() {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            bool is_clock_set = false;
+            while (!m_shutdown) {
+                // a change of the offset between the clocks is a step of the wall clock
+                const int64_t offset = get_clock_offset();
+                const int64_t diff = offset - m_offset;
+                if (is_clock_set || diff > (int64_t)NS_PER_SEC / 100 || diff < -(int64_t)NS_PER_SEC / 100) {
+                    m_offset = offset;
+                    rearm(get_wall_ns() / NS_PER_SEC);
+                }
+                const uint64_t now = get_wall_ns();
+                if (Job *job = static_cast<Job*>(m_queue.pop_due(now))) {
+                    // missed times are skipped
+                    job->next = job->expression.next(now / NS_PER_SEC, job->zone);
+                    if (job->next != CronExpression::NO_TIME) {
+                        job->deadline = job->next * NS_PER_SEC;
+                        m_queue.push(job);
+                    }
+                    m_running = job->id;
+                    lock.unlock();
+                    job->callback();
+                    lock.lock();
+                    m_running = 0;
+                    m_removed.reset();
+                    m_done_cv.notify_all();
+                    continue;
+                }
+                is_clock_set = sleep_until(lock, m_queue.next_deadline());
+            }
+        }
+    };
+
+}; // ztime
+
+#endif // ZTIME_CRON_HPP_INCLUDED
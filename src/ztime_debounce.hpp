@@ -0,0 +1,311 @@
+/*
+* ztime_cpp - Library for work with time.
+*
+* Copyright (c) 2018 Elektro Yar. Email: git.electroyar@gmail.com
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#pragma once
+#ifndef ZTIME_DEBOUNCE_HPP_INCLUDED
+#define ZTIME_DEBOUNCE_HPP_INCLUDED
+
+#include "ztime.hpp"
+#include "parts/ztime_timer_service.hpp"
+#include <functional>
+#include <unordered_map>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+
+namespace ztime {
+
+    /** \brief Base of keyed timers
+     *
+     * A key has a timer of the service only while it is active, so the memory
+     * is bounded by the number of active keys, and removed timers are reused
+     * by the service. A touch of an active key only writes the entry of the key,
+     * the timer itself checks the entry when it expires. The timer captures
+     * the key and the shared state, so the key must fit into the callback
+     * of the service (40 bytes, std::string fits). A timer which runs after
+     * the destruction finds the state closed and stops.
+     * Callbacks of different keys may run in parallel if the service has
+     * an executor, callbacks of one key never run in parallel.
+     */
+    template<class Key, class Hash = std::hash<Key>>
+    class KeyedTimer {
+    public:
+        typedef std::function<void(const Key &)> callback_t;
+
+        /** \brief Constructor of keyed timers
+         * \param interval_ns   Interval, ns
+         * \param callback      Callback of the key
+         * \param service       Service of the timers
+         */
+        KeyedTimer(
+                const uint64_t interval_ns,
+                callback_t callback,
+                TimerService &service = TimerService::get_shared()) :
+                m_state(std::make_shared<State>(service, interval_ns, std::move(callback))) {
+        }
+
+        KeyedTimer(const KeyedTimer &) = delete;
+        KeyedTimer &operator=(const KeyedTimer &) = delete;
+
+        /** \brief Destructor
+         * Waits for the running callbacks, must not be called from a callback of the service
+         */
+        ~KeyedTimer() {
+            {
+                std::lock_guard<std::mutex> lock(m_state->mutex);
+                m_state->is_closed = true;
+            }
+            clear();
+        }
+
+        /** \brief Forget the key without calling the callback
+         * \param key Key
+         */
+        void cancel(const Key &key) {
+            uint64_t id = 0;
+            {
+                std::lock_guard<std::mutex> lock(m_state->mutex);
+                auto it = m_state->entries.find(key);
+                if (it == m_state->entries.end()) return;
+                id = it->second.id;
+                m_state->entries.erase(it);
+            }
+            // a running timer of the key does not find its entry and stops
+            m_state->service.cancel(id);
+        }
+
+        /** \brief Forget all keys without calling the callbacks
+         * Waits for the running callbacks, unless it is called from a callback
+         */
+        void clear() {
+            std::vector<uint64_t> ids;
+            {
+                std::lock_guard<std::mutex> lock(m_state->mutex);
+                ids.reserve(m_state->entries.size());
+                for (auto &it : m_state->entries) {
+                    ids.push_back(it.second.id);
+                }
+                m_state->entries.clear();
+            }
+            m_state->service.remove_many(ids);
+            if (current_state()) return;
+            // callbacks of keys which were cancelled or have expired are not among the timers
+            std::unique_lock<std::mutex> lock(m_state->mutex);
+            m_state->done_cv.wait(lock, [this] {
+                return !m_state->running;
+            });
+        }
+
+        /** \brief Reserve the memory for the number of active keys
+         */
+        void reserve(const size_t count) {
+            std::lock_guard<std::mutex> lock(m_state->mutex);
+            m_state->entries.reserve(count);
+        }
+
+        /** \brief Get the number of active keys
+         */
+        size_t size() const {
+            std::lock_guard<std::mutex> lock(m_state->mutex);
+            return m_state->entries.size();
+        }
+
+    protected:
+
+        struct Entry {
+            uint64_t    id = 0;             /**< Id of the timer of the service */
+            uint64_t    token = 0;          /**< Number of the timer, a timer of a removed entry does not match */
+            uint64_t    touched = 0;        /**< Time of the last touch, ns */
+            bool        is_touched = false; /**< The key was touched since the last callback */
+        };
+
+        /** \brief State shared with the timers of the keys
+         */
+        struct State {
+            TimerService                            &service;
+            const uint64_t                          interval;
+            callback_t                              callback;
+            std::mutex                              mutex;
+            std::condition_variable                 done_cv;
+            std::unordered_map<Key, Entry, Hash>    entries;
+            uint64_t                                token = 0;
+            size_t                                  running = 0;        /**< Number of running callbacks */
+            bool                                    is_closed = false;  /**< The owner is destroyed */
+
+            State(TimerService &s, const uint64_t i, callback_t c) :
+                service(s), interval(i ? i : 1), callback(std::move(c)) {};
+        };
+
+        std::shared_ptr<State> m_state;
+
+        /** \brief Add the entry of the key with a new token
+         * Must be called under the lock, the caller adds the timer of the entry
+         */
+        inline Entry &add_entry(const Key &key) {
+            Entry &entry = m_state->entries[key];
+            entry.token = ++m_state->token;
+            return entry;
+        }
+
+        /** \brief Find the entry of the timer
+         * Must be called under the lock
+         * \return Entry or nullptr if the key was cancelled or touched again after the expiry
+         */
+        static inline Entry *find_entry(State &state, const Key &key, const uint64_t token) {
+            if (state.is_closed) return nullptr;
+            auto it = state.entries.find(key);
+            if (it == state.entries.end() || it->second.token != token) return nullptr;
+            return &it->second;
+        }
+
+        /** \brief Call the callback of the key outside the lock
+         * Must be called under the lock, which is released during the callback.
+         * clear() waits for the callback even if the entry is already removed.
+         */
+        static inline void run(State &state, std::unique_lock<std::mutex> &lock, const Key &key) {
+            ++state.running;
+            lock.unlock();
+            const State *prev_state = current_state();
+            current_state() = &state;
+            state.callback(key);
+            current_state() = prev_state;
+            lock.lock();
+            // the waiter may destroy the owner as soon as the lock is released
+            if (!--state.running) state.done_cv.notify_all();
+        }
+
+        /** \brief State whose callback is executed by the current thread
+         */
+        static inline const State *&current_state() noexcept {
+            static thread_local const State *state = nullptr;
+            return state;
+        }
+    };
+
+    /** \brief Keyed debouncer
+     *
+     * The callback of a key is called once the key has not been touched
+     * for the interval, so a burst of updates of an instrument is delivered once.
+     * touch() is O(1): the timer of an active key is not moved, it finds the
+     * later touch when it expires and waits for the rest of the interval.
+     */
+    template<class Key, class Hash = std::hash<Key>>
+    class Debouncer : public KeyedTimer<Key, Hash> {
+    public:
+        typedef KeyedTimer<Key, Hash> base_t;
+
+        using base_t::base_t;
+
+        /** \brief Restart the interval of the key
+         * \param key Key
+         */
+        void touch(const Key &key) {
+            typename base_t::State &state = *this->m_state;
+            std::lock_guard<std::mutex> lock(state.mutex);
+            const uint64_t now = state.service.get_now();
+            auto it = state.entries.find(key);
+            if (it != state.entries.end()) {
+                it->second.touched = now;
+                return;
+            }
+            typename base_t::Entry &entry = this->add_entry(key);
+            const uint64_t token = entry.token;
+            entry.touched = now;
+            std::shared_ptr<typename base_t::State> shared = this->m_state;
+            entry.id = state.service.add([shared, key, token]() -> uint64_t {
+                return on_timer(*shared, key, token);
+            }, state.interval, FIXED_DELAY);
+        }
+
+    private:
+
+        static uint64_t on_timer(typename base_t::State &state, const Key &key, const uint64_t token) {
+            std::unique_lock<std::mutex> lock(state.mutex);
+            typename base_t::Entry *entry = base_t::find_entry(state, key, token);
+            if (!entry) return 0;
+            const uint64_t deadline = entry->touched + state.interval;
+            const uint64_t now = state.service.get_now();
+            // the rest of the interval after the last touch
+            if (deadline > now) return deadline - now;
+            state.entries.erase(key);
+            base_t::run(state, lock, key);
+            return 0;
+        }
+    };
+
+    /** \brief Keyed throttler
+     *
+     * The first touch of an idle key is delivered at once, further touches
+     * are delivered at most once per interval, at the end of the interval
+     * in which they happened. A key which was not touched for an interval becomes idle.
+     * touch() is O(1).
+     */
+    template<class Key, class Hash = std::hash<Key>>
+    class Throttler : public KeyedTimer<Key, Hash> {
+    public:
+        typedef KeyedTimer<Key, Hash> base_t;
+
+        using base_t::base_t;
+
+        /** \brief Touch the key
+         * \param key Key
+         */
+        void touch(const Key &key) {
+            typename base_t::State &state = *this->m_state;
+            std::lock_guard<std::mutex> lock(state.mutex);
+            auto it = state.entries.find(key);
+            if (it != state.entries.end()) {
+                it->second.is_touched = true;
+                return;
+            }
+            typename base_t::Entry &entry = this->add_entry(key);
+            const uint64_t token = entry.token;
+            entry.is_touched = true;
+            std::shared_ptr<typename base_t::State> shared = this->m_state;
+            // the shortest period delivers the first touch from the thread of the service,
+            // the next interval is counted from the end of the callback
+            entry.id = state.service.add([shared, key, token]() -> uint64_t {
+                return on_timer(*shared, key, token);
+            }, 1, FIXED_DELAY);
+        }
+
+    private:
+
+        static uint64_t on_timer(typename base_t::State &state, const Key &key, const uint64_t token) {
+            std::unique_lock<std::mutex> lock(state.mutex);
+            typename base_t::Entry *entry = base_t::find_entry(state, key, token);
+            if (!entry) return 0;
+            if (!entry->is_touched) {
+                state.entries.erase(key);
+                return 0;
+            }
+            entry->is_touched = false;
+            base_t::run(state, lock, key);
+            return state.interval;
+        }
+    };
+
+}; // ztime
+
+#endif // ZTIME_DEBOUNCE_HPP_INCLUDED
@@ -0,0 +1,151 @@
+/*
+* ztime_cpp - Library for work with time.
+*
+* Copyright (c) 2018 Elektro Yar. Email: git.electroyar@gmail.com
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#pragma once
+#ifndef ZTIME_IDLE_TIMEOUT_HPP_INCLUDED
+#define ZTIME_IDLE_TIMEOUT_HPP_INCLUDED
+
+#include "ztime.hpp"
+#include "parts/ztime_timer_service.hpp"
+#include <functional>
+#include <atomic>
+
+namespace ztime {
+
+    /** \brief Idle timeout of a connection with a lazy reset
+     *
+     * touch() only stores the time of the activity in a relaxed atomic,
+     * the timer is not moved. When the timer expires, it compares the
+     * stored time with the deadline: if there was an activity, the timer
+     * is armed again for the rest of the timeout, otherwise the callback
+     * is called. The timer wakes up at most once per timeout, however
+     * often the connection is touched.
+     *
+     * After the expiry the timeout stays expired until restart().
+     * Each restart() begins a new generation of the countdown, an expiry
+     * which is running sets the flag only in the generation it has checked.
+     * The object is neither copied nor moved, the timer refers to it.
+     */
+    class IdleTimeout {
+    public:
+        typedef std::function<void()> callback_t;
+
+        /** \brief Constructor of the timeout
+         * The countdown starts at once
+         * \param timeout_ns    Timeout, ns
+         * \param callback      Callback of the expiry
+         * \param service       Service of the timer
+         */
+        IdleTimeout(
+                const uint64_t timeout_ns,
+                callback_t callback,
+                TimerService &service = TimerService::get_shared()) :
+                m_service(service),
+                m_callback(std::move(callback)),
+                m_timeout(timeout_ns ? timeout_ns : 1),
+                m_last(service.get_now()) {
+            m_id = m_service.add([this]() -> uint64_t {
+                return on_timer();
+            }, m_timeout, FIXED_DELAY);
+        }
+
+        IdleTimeout(const IdleTimeout &) = delete;
+        IdleTimeout &operator=(const IdleTimeout &) = delete;
+
+        /** \brief Destructor
+         * Waits for the running callback, unless it is called from a callback of the service
+         */
+        ~IdleTimeout() {
+            m_service.remove(m_id);
+        }
+
+        /** \brief Note an activity
+         * Reads the clock of the service and stores the time
+         */
+        inline void touch() noexcept {
+            m_last.store(m_service.get_now(), std::memory_order_relaxed);
+        }
+
+        /** \brief Note an activity at the time
+         * A loop which reads a batch of packets may read the clock once
+         * and touch every connection of the batch with a single store.
+         * \param now_ns Time of the clock of the service, ns
+         */
+        inline void touch(const uint64_t now_ns) noexcept {
+            m_last.store(now_ns, std::memory_order_relaxed);
+        }
+
+        /** \brief Start the countdown again after the expiry or before it
+         */
+        void restart() {
+            touch();
+            // the next generation with the flag of the expiry cleared
+            uint64_t state = m_state.load();
+            while (!m_state.compare_exchange_weak(state, (state | EXPIRED) + 1)) {};
+            // a reset survives an expiry which is running, the timer finds
+            // the activity and waits for the rest of the timeout
+            m_service.reset(m_id);
+        }
+
+        /** \brief Get the time of the last activity
+         * \return Time of the clock of the service, ns
+         */
+        inline uint64_t get_last_activity() const noexcept {
+            return m_last.load(std::memory_order_relaxed);
+        }
+
+        inline uint64_t get_timeout() const noexcept {
+            return m_timeout;
+        }
+
+        inline bool is_expired() const noexcept {
+            return (m_state.load() & EXPIRED) != 0;
+        }
+
+    private:
+        TimerService            &m_service;
+        callback_t              m_callback;
+        const uint64_t          m_timeout;
+        std::atomic<uint64_t>   m_last;
+        std::atomic<uint64_t>   m_state = ATOMIC_VAR_INIT(0);   /**< Generation of restart() in the high bits, the flag of the expiry in bit 0 */
+        uint64_t                m_id = 0;
+
+        static const uint64_t EXPIRED = 1;
+
+        uint64_t on_timer() {
+            // the generation is read before the activity, restart() touches before the next generation
+            uint64_t state = m_state.load() & ~EXPIRED;
+            const uint64_t deadline = get_last_activity() + m_timeout;
+            const uint64_t now = m_service.get_now();
+            // the connection was touched after the timer was armed
+            if (deadline > now) return deadline - now;
+            // restart() after the check, the countdown has begun again
+            if (!m_state.compare_exchange_strong(state, state | EXPIRED)) return m_timeout;
+            m_callback();
+            return TimerService::DISARM;
+        }
+    };
+
+}; // ztime
+
+#endif // ZTIME_IDLE_TIMEOUT_HPP_INCLUDED
@@ -0,0 +1,315 @@
+/*
+* ztime_cpp - Library for work with time.
+*
+* Copyright (c) 2018 Elektro Yar. Email: git.electroyar@gmail.com
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#pragma once
+#ifndef ZTIME_SESSION_CALENDAR_HPP_INCLUDED
+#define ZTIME_SESSION_CALENDAR_HPP_INCLUDED
+
+#include "ztime.hpp"
+#include <vector>
+#include <set>
+#include <map>
+
+namespace ztime {
+
+    /** \brief Trading session calendar
+     *
+     * The calendar is defined by a time zone, weekly session windows,
+     * holidays and half-days. After compile() all sessions of the range
+     * are stored as a sorted table of GMT periods with a per-day index,
+     * so is_open() costs O(1) and the other queries cost at most O(log n).
+     * Session windows, holidays and half-days are set in the local time of the zone.
+     */
+    class SessionCalendar {
+    public:
+
+        SessionCalendar() {};
+
+        /** \brief Set the time zone of the sessions
+         * \param zone Time zone (GMT, CET, EET, MSK)
+         */
+        inline void set_zone(const TimeZone zone) noexcept {
+            m_zone = zone;
+        }
+
+        /** \brief Set an additional fixed offset from the time zone
+         * Use it with GMT for venues with a fixed UTC offset
+         * \param offset Offset in seconds (local time = zone time + offset)
+         */
+        inline void set_utc_offset(const int64_t offset) noexcept {
+            m_offset = offset;
+        }
+
+        /** \brief Add a weekly session window
+         * \param weekday       Day of the week of the session opening (SUN = 0, MON = 1, ... SAT = 6)
+         * \param open_second   Second of the day of the session opening
+         * \param close_second  Second of the day of the session closing. Values above SEC_PER_DAY continue the session into the next day
+         * \return Returns true if the window is correct
+         */
+        inline bool add_session(
+                const uint32_t weekday,
+                const uint32_t open_second,
+                const uint32_t close_second) noexcept {
+            if (weekday >= DAYS_PER_WEEK) return false;
+            if (open_second >= close_second) return false;
+            if (open_second >= SEC_PER_DAY) return false;
+            if (close_second > 2 * SEC_PER_DAY) return false;
+            m_windows[weekday].push_back(Window(open_second, close_second));
+            return true;
+        }
+
+        /** \brief Add a session window for a range of weekdays
+         * \param weekday_from  First day of the week (SUN = 0, MON = 1, ... SAT = 6)
+         * \param weekday_to    Last day of the week, inclusive
+         * \param open_second   Second of the day of the session opening
+         * \param close_second  Second of the day of the session closing
+         * \return Returns true if the window is correct
+         */
+        inline bool add_session(
+                const uint32_t weekday_from,
+                const uint32_t weekday_to,
+                const uint32_t open_second,
+                const uint32_t close_second) noexcept {
+            if (weekday_from > weekday_to) return false;
+            for (uint32_t wday = weekday_from; wday <= weekday_to; ++wday) {
+                if (!add_session(wday, open_second, close_second)) return false;
+            }
+            return true;
+        }
+
+        /** \brief Add a holiday
+         * All sessions opening on this day are removed
+         * \param day   Day
+         * \param month Month
+         * \param year  Year
+         */
+        inline void add_holiday(const uint32_t day, const uint32_t month, const uint32_t year) {
+            m_holidays.insert(get_day(get_timestamp(day, month, year)));
+        }
+
+        /** \brief Add a holiday
+         * \param local Any timestamp of the day in the local time of the zone
+         */
+        inline void add_holiday(const timestamp_t local) {
+            m_holidays.insert(get_day(local));
+        }
+
+        /** \brief Add a half-day
+         * Sessions opening on this day are closed no later than close_second
+         * \param day           Day
+         * \param month         Month
+         * \param year          Year
+         * \param close_second  Second of the day of the early closing
+         */
+        inline void add_half_day(
+                const uint32_t day,
+                const uint32_t month,
+                const uint32_t year,
+                const uint32_t close_second) {
+            m_half_days[get_day(get_timestamp(day, month, year))] = close_second;
+        }
+
+        /** \brief Remove all windows, holidays, half-days and the compiled table
+         */
+        inline void clear() noexcept {
+            for (size_t i = 0; i < DAYS_PER_WEEK; ++i) {
+                m_windows[i].clear();
+            }
+            m_holidays.clear();
+            m_half_days.clear();
+            m_sessions.clear();
+            m_prefix.clear();
+            m_day_index.clear();
+        }
+
+        /** \brief Compile the lookup table
+         * Queries outside of the compiled range see the market as closed
+         * \param start Beginning of the range, GMT
+         * \param stop  End of the range, GMT
+         * \return Returns true if the table has been built
+         */
+        bool compile(const timestamp_t start, const timestamp_t stop) {
+            if (start > stop) return false;
+            m_sessions.clear();
+            m_prefix.clear();
+            m_day_index.clear();
+
+            m_first_day = get_day(start);
+            m_last_day = get_day(stop);
+
+            // the local calendar may be shifted relative to GMT, so one extra day is added on each side
+            const uint32_t first_local_day = m_first_day > 2 ? m_first_day - 2 : 0;
+            const uint32_t last_local_day = m_last_day + 2;
+
+            for (uint32_t day = first_local_day; day <= last_local_day; ++day) {
+                if (m_holidays.count(day)) continue;
+                const std::vector<Window> &windows = m_windows[(day + THU) % DAYS_PER_WEEK];
+                if (windows.empty()) continue;
+
+                uint32_t half_day_close = 2 * SEC_PER_DAY;
+                auto it = m_half_days.find(day);
+                if (it != m_half_days.end()) half_day_close = it->second;
+
+                const timestamp_t local_day = get_timestamp_day(day);
+                for (size_t i = 0; i < windows.size(); ++i) {
+                    const uint32_t close_second = std::min(windows[i].close, half_day_close);
+                    if (close_second <= windows[i].open) continue;
+                    const timestamp_t open = to_gmt(local_day + windows[i].open);
+                    const timestamp_t close = to_gmt(local_day + close_second);
+                    if (close <= open) continue;
+                    m_sessions.push_back(period_t(open, close - 1));
+                }
+            }
+
+            // sorting and merging of adjacent sessions
+            std::sort(m_sessions.begin(), m_sessions.end(),
+                [](const period_t &a, const period_t &b) {
+                    return a.start < b.start;
+                });
+            size_t n = 0;
+            for (size_t i = 0; i < m_sessions.size(); ++i) {
+                if (n > 0 && m_sessions[i].start <= (m_sessions[n - 1].stop + 1)) {
+                    m_sessions[n - 1].stop = std::max(m_sessions[n - 1].stop, m_sessions[i].stop);
+                    continue;
+                }
+                m_sessions[n++] = m_sessions[i];
+            }
+            m_sessions.resize(n);
+
+            m_prefix.resize(n + 1);
+            m_prefix[0] = 0;
+            for (size_t i = 0; i < n; ++i) {
+                m_prefix[i + 1] = m_prefix[i] + (m_sessions[i].stop - m_sessions[i].start + 1);
+            }
+
+            // index of the first session which is not over at the beginning of each day
+            m_day_index.resize(m_last_day - m_first_day + 2);
+            size_t index = 0;
+            for (uint32_t day = m_first_day; day <= (m_last_day + 1); ++day) {
+                const timestamp_t t = get_timestamp_day(day);
+                while (index < n && m_sessions[index].stop < t) ++index;
+                m_day_index[day - m_first_day] = (uint32_t)index;
+            }
+            return true;
+        }
+
+        /** \brief Check that the market is open
+         * \param t Timestamp, GMT
+         * \return Returns true if the market is open
+         */
+        inline bool is_open(const timestamp_t t) const noexcept {
+            const size_t index = locate(t);
+            return index < m_sessions.size() && m_sessions[index].start <= t;
+        }
+
+        /** \brief Get the beginning of the next session
+         * \param t Timestamp, GMT
+         * \return Returns the opening time of the first session starting at t or later, or MAX_TIMESTAMP
+         */
+        inline timestamp_t next_open(const timestamp_t t) const noexcept {
+            size_t index = locate(t);
+            if (index < m_sessions.size() && m_sessions[index].start < t) ++index;
+            if (index >= m_sessions.size()) return MAX_TIMESTAMP;
+            return m_sessions[index].start;
+        }
+
+        /** \brief Get the closing time of the current or the next session
+         * \param t Timestamp, GMT
+         * \return Returns the first closed second after the session, or MAX_TIMESTAMP
+         */
+        inline timestamp_t next_close(const timestamp_t t) const noexcept {
+            const size_t index = locate(t);
+            if (index >= m_sessions.size()) return MAX_TIMESTAMP;
+            return m_sessions[index].stop + 1;
+        }
+
+        /** \brief Get the number of trading seconds in the interval [a, b)
+         * \param a Beginning of the interval, GMT
+         * \param b End of the interval, GMT
+         * \return Number of seconds when the market is open
+         */
+        inline uint64_t trading_seconds_between(const timestamp_t a, const timestamp_t b) const noexcept {
+            if (b <= a) return 0;
+            return trading_seconds_before(b) - trading_seconds_before(a);
+        }
+
+        /** \brief Get the compiled sessions
+         * \return Sorted array of sessions, GMT. The end of the period is the last open second
+         */
+        inline const std::vector<period_t> &get_sessions() const noexcept {
+            return m_sessions;
+        }
+
+    private:
+
+        struct Window {
+            uint32_t open;
+            uint32_t close;
+
+            Window(const uint32_t o, const uint32_t c) : open(o), close(c) {};
+        };
+
+        std::vector<Window>             m_windows[DAYS_PER_WEEK];
+        std::set<uint32_t>              m_holidays;
+        std::map<uint32_t, uint32_t>    m_half_days;
+        TimeZone                        m_zone = GMT;
+        int64_t                         m_offset = 0;
+
+        std::vector<period_t>   m_sessions;     /**< Sorted sessions, GMT */
+        std::vector<uint64_t>   m_prefix;       /**< Trading seconds before each session */
+        std::vector<uint32_t>   m_day_index;    /**< First session not over at the beginning of the day */
+        uint32_t                m_first_day = 0;
+        uint32_t                m_last_day = 0;
+
+        inline timestamp_t to_gmt(const timestamp_t local) const {
+            return convert_zone_to_gmt((timestamp_t)((int64_t)local - m_offset), m_zone);
+        }
+
+        /** \brief Find the first session which is not over at the moment t
+         */
+        inline size_t locate(const timestamp_t t) const noexcept {
+            if (m_day_index.empty()) return 0;
+            const uint32_t day = get_day(t);
+            if (day < m_first_day) return m_day_index.front();
+            if (day > m_last_day) return m_sessions.size();
+            size_t index = m_day_index[day - m_first_day];
+            while (index < m_sessions.size() && m_sessions[index].stop < t) ++index;
+            return index;
+        }
+
+        /** \brief Get the number of trading seconds before the moment t
+         */
+        inline uint64_t trading_seconds_before(const timestamp_t t) const noexcept {
+            if (m_sessions.empty()) return 0;
+            const size_t index = locate(t);
+            uint64_t seconds = m_prefix[index];
+            if (index < m_sessions.size() && m_sessions[index].start < t) {
+                seconds += t - m_sessions[index].start;
+            }
+            return seconds;
+        }
+    };
+
+}; // ztime
+
+#endif // ZTIME_SESSION_CALENDAR_HPP_INCLUDED
@@ -1,146 +1,31 @@
 #ifndef ZTIME_TIMER_EVENT_HPP_INCLUDED
 #define ZTIME_TIMER_EVENT_HPP_INCLUDED
 
-#include <functional>
-#include <thread>
 #include <chrono>
-#include <future>
+#include <limits>
+#include <thread>
+#include <functional>
+#include <type_traits>
+#include <mutex>
 #include <vector>
 #include <map>
+#include <memory>
+#include "parts/ztime_timer_service.hpp"
+#include "parts/ztime_slot_map.hpp"
 
 namespace ztime {
 
     class event {
     private:
 
-        class TimerEventHandler {
-        private:
-            std::vector<std::function<size_t()>>                        callbacks;
-            std::vector<std::chrono::high_resolution_clock::time_point> starts;
-            std::vector<std::chrono::milliseconds>                      delays;
-
-            std::mutex method_mutex;
-            std::mutex timer_future_mutex;
-
-            std::map<size_t, size_t> id_to_index;
-            size_t id_counter = 0;
-
-            inline void offset_id_to_index(const size_t index) noexcept {
-                for (auto &item : id_to_index) {
-                    if (item.second == index) {
-                        const size_t id = item.first;
-                        id_to_index.erase(id);
-                        break;
-                    }
-                }
-                for (auto &item : id_to_index) {
-                    if (item.second > index) item.second -= 1;
-                }
-            }
-
-            std::atomic<bool> is_shutdown = ATOMIC_VAR_INIT(false);
-            std::atomic<bool> is_init = ATOMIC_VAR_INIT(false);
-
-            std::future<void> timer_future;
-        public:
-
-            TimerEventHandler() {};
-
-            ~TimerEventHandler() {
-                is_shutdown = true;
-                remove_all();
-                try {
-                    std::shared_future<void> share = timer_future.share();
-                    if (share.valid()) {
-                        share.wait();
-                        share.get();
-                    }
-                } catch(...) {}
-            };
-
-            inline void run() noexcept {
-                std::lock_guard<std::mutex> lock(timer_future_mutex);
-                if (is_init) return;
-                is_init = true;
-                timer_future = std::async(std::launch::async, [&] {
-                    while (!is_shutdown) {
-                        {//>
-                            std::lock_guard<std::mutex> lock(method_mutex);
-                            for (size_t i = 0; i < callbacks.size(); ++i) {
-                                while (i < callbacks.size()) {
-                                    if ((std::chrono::high_resolution_clock::now() - starts[i]) < delays[i]) break;
-                                    const size_t result = callbacks[i]();
-                                    if (!result) {
-                                        callbacks.erase(callbacks.begin() + i);
-                                        starts.erase(starts.begin() + i);
-                                        delays.erase(delays.begin() + i);
-                                        offset_id_to_index(i);
-                                        continue;
-                                    }
-                                    delays[i] = std::chrono::milliseconds(result);
-                                    starts[i] += delays[i];
-                                    while ((std::chrono::high_resolution_clock::now() - starts[i]) > delays[i]) {
-                                        starts[i] += delays[i];
-                                    }
-                                    break;
-                                } // while i
-                            } // for i
-                        }//<
-                        std::this_thread::yield();
-                        std::this_thread::sleep_for(std::chrono::milliseconds(1));
-                    }
-                });
-            }
-
-            inline size_t add(
-                    std::function<size_t()> callback,
-                    const size_t delay_ms) noexcept {
-                std::lock_guard<std::mutex> lock(method_mutex);
-                callbacks.push_back(callback);
-                starts.push_back(std::chrono::high_resolution_clock::now());
-                delays.push_back(std::chrono::milliseconds(delay_ms));
-                const size_t index = callbacks.size() - 1;
-                const size_t id = id_counter++;
-                id_to_index[id] = index;
-                return id;
-            }
-
-            inline void reset(const size_t id) noexcept {
-                std::lock_guard<std::mutex> lock(method_mutex);
-                auto it = id_to_index.find(id);
-                if (it == id_to_index.end()) return;
-                const size_t index = it->second;
-                if (index >= callbacks.size()) return;
-                starts[index] = std::chrono::high_resolution_clock::now();
-            }
+        /// Handler of a thread of events
+        typedef TimerService TimerEventHandler;
 
-            inline void remove_all() noexcept {
-                std::lock_guard<std::mutex> lock(method_mutex);
-                callbacks.clear();
-                starts.clear();
-                delays.clear();
-                id_to_index.clear();
-            }
-
-            inline void remove(const size_t id) noexcept {
-                std::lock_guard<std::mutex> lock(method_mutex);
-                auto it = id_to_index.find(id);
-                if (it == id_to_index.end()) return;
-                const size_t index = it->second;
-                if (index >= callbacks.size()) return;
-                callbacks.erase(callbacks.begin() + index);
-                starts.erase(starts.begin() + index);
-                delays.erase(delays.begin() + index);
-                offset_id_to_index(index);
-            }
-
-            inline size_t get_num_events() noexcept {
-                std::lock_guard<std::mutex> lock(method_mutex);
-                return callbacks.size();
-            }
-        }; // TimerEvent
-
-        inline static std::map<size_t, TimerEventHandler> handlers;
+        inline static std::map<size_t, std::shared_ptr<TimerEventHandler>> handlers;
+        inline static std::map<size_t, TimerBackend> backends;
+        inline static std::map<size_t, std::shared_ptr<Executor>> executors;
+        inline static std::map<size_t, std::shared_ptr<VirtualClock>> clocks;
+        inline static std::map<size_t, ThreadConfig> configs;
         inline static std::mutex handlers_mutex;
 
     public:
@@ -157,14 +42,57 @@ namespace ztime {
          * 7. Если событие длилось дольше своего периода, следующее событие переносится на картное периоду время
          * 8. Если вернуть длительность 0 внутри callback, событие будет удалено
          * 9. Следующие события строго смещаются на значение delay_ms
+         * 10. Поток событий спит до ближайшего события и не нагружает процессор в простое
+         * 11. Callback-функции вызываются без блокировки, их можно выполнять в пуле потоков (set_executor)
+         * 12. Период можно задать в мкс и нс (std::chrono), с хвостом активного ожидания перед событием
+         * 13. Допуск (slack) позволяет обслужить несколько событий за одно пробуждение потока
+         * 14. События потока можно вызывать по виртуальным часам (set_clock) для воспроизведения данных
+         * 15. Индекс потока AUTO распределяет события по потокам с перехватом работы (work stealing)
+         * 16. Callback-функции хранятся без выделения памяти в куче и могут быть только перемещаемыми
+         * 17. События можно добавлять и удалять пакетами (add_many, remove_many)
+         * 18. Потоку событий можно задать имя, ядра процессора, приоритет SCHED_FIFO и блокировку памяти
          */
         class TimerEvent {
         private:
-            std::vector<size_t> indexes;
-            std::vector<size_t> thread_indexes;
+
+            struct Item {
+                uint64_t id = 0;                                /**< Id of the event in the handler */
+                size_t thread_index = 0;
+                std::shared_ptr<TimerEventHandler> handler;
+            };
+
+            /// Callback with the period in ms, the handler measures time in ns
+            template<class F>
+            struct MsCallback {
+                F callback;
+
+                inline uint64_t operator()() {
+                    return (uint64_t)callback() * TimerService::NS_PER_MS;
+                }
+            };
+
+            /// Callback with the period as std::chrono::duration
+            template<class F>
+            struct NsCallback {
+                F callback;
+
+                inline uint64_t operator()() {
+                    return (uint64_t)std::chrono::nanoseconds(callback()).count();
+                }
+            };
+
+            SlotMap<Item> items;
             std::mutex method_mutex;
         public:
 
+            /** \brief Индекс потока для автоматического размещения событий
+             * Сроки событий отслеживает один поток, а callback-функции выполняются
+             * пулом WorkStealingExecutor: у каждого потока пула своя очередь,
+             * свободные потоки забирают задачи из очередей занятых потоков.
+             * Пул можно заменить через set_executor(executor, AUTO).
+             */
+            static const size_t AUTO = std::numeric_limits<size_t>::max();
+
             TimerEvent() {}
 
             ~TimerEvent() {
@@ -172,66 +100,307 @@ namespace ztime {
             }
 
             /** \brief Добавить callback-функцию события
-             * \param callback      Callback-функция события
+             * \param callback      Callback-функция события, может быть только перемещаемой,
+             *                      хранится без выделения памяти в куче
              * \param delay_ms      Задержка времени события, в мс.
-             * \param thread_index  Индекс потока события
-             * \return Вернет индекс события для данного экземпляра класса
+             * \param thread_index  Индекс потока события, AUTO - любой свободный поток пула
+             * \param slack_ms      Допустимое опоздание события, в мс.
+             * \return Вернет дескриптор события для данного экземпляра класса
              */
-            inline size_t add(
-                    std::function<size_t()> callback,
+            template<class F, typename std::enable_if<std::is_convertible<typename std::result_of<F&()>::type, size_t>::value, int>::type = 0>
+            inline uint64_t add(
+                    F callback,
                     const size_t delay_ms,
+                    const size_t thread_index = 0,
+                    const size_t slack_ms = 0) noexcept {
+                return add_event(MsCallback<F>{std::move(callback)},
+                (uint64_t)delay_ms * TimerService::NS_PER_MS, thread_index,
+                0, (uint64_t)slack_ms * TimerService::NS_PER_MS);
+            }
+
+            /** \brief Добавить callback-функцию события с периодом в мкс или нс
+             * Хвост активного ожидания (spin) будит поток событий раньше срока,
+             * и поток ждет срок в цикле. Это снижает дрожание до единиц мкс
+             * ценой процессорного времени.
+             * \param callback      Callback-функция события, возвращает следующий период
+             * \param delay         Задержка времени события
+             * \param thread_index  Индекс потока события, AUTO - любой свободный поток пула
+             * \param spin          Хвост активного ожидания, 0 - без активного ожидания
+             * \param slack         Допустимое опоздание события
+             * \return Вернет дескриптор события для данного экземпляра класса
+             */
+            template<class F, typename std::enable_if<std::is_convertible<typename std::result_of<F&()>::type, std::chrono::nanoseconds>::value, int>::type = 0>
+            inline uint64_t add(
+                    F callback,
+                    const std::chrono::nanoseconds delay,
+                    const size_t thread_index = 0,
+                    const std::chrono::nanoseconds spin = std::chrono::nanoseconds(0),
+                    const std::chrono::nanoseconds slack = std::chrono::nanoseconds(0)) noexcept {
+                return add_event(NsCallback<F>{std::move(callback)}, (uint64_t)delay.count(), thread_index, (uint64_t)spin.count(), (uint64_t)slack.count());
+            }
+
+            /** \brief Добавить несколько callback-функций событий с одной задержкой
+             * Блокировки берутся один раз, поток событий получает одну команду
+             * и строит очередь таймеров за O(n). Подходит для десятков тысяч событий.
+             * \param callbacks     Callback-функции событий
+             * \param delay_ms      Задержка времени событий, в мс.
+             * \param thread_index  Индекс потока событий, AUTO - любой свободный поток пула
+             * \param slack_ms      Допустимое опоздание событий, в мс.
+             * \return Вернет дескрипторы событий в порядке callback-функций
+             */
+            template<class F, typename std::enable_if<std::is_convertible<typename std::result_of<F&()>::type, size_t>::value, int>::type = 0>
+            inline std::vector<uint64_t> add_many(
+                    std::vector<F> callbacks,
+                    const size_t delay_ms,
+                    const size_t thread_index = 0,
+                    const size_t slack_ms = 0) noexcept {
+                std::vector<TimerEventHandler::TimerSpec> specs;
+                specs.reserve(callbacks.size());
+                for (size_t i = 0; i < callbacks.size(); ++i) {
+                    specs.emplace_back(MsCallback<F>{std::move(callbacks[i])}, (uint64_t)delay_ms * TimerService::NS_PER_MS, FIXED_RATE,
+                    0, (uint64_t)slack_ms * TimerService::NS_PER_MS);
+                }
+                return add_events(specs, thread_index);
+            }
+
+        private:
+
+            inline uint64_t add_event(
+                    TimerEventHandler::callback_t callback,
+                    const uint64_t delay_ns,
+                    const size_t thread_index,
+                    const uint64_t spin_ns,
+                    const uint64_t slack_ns) noexcept {
+                Item item;
+                item.thread_index = thread_index;
+                {
+                    // remove_all() does not erase the handler while the event is being added
+                    std::lock_guard<std::mutex> lock(handlers_mutex);
+                    item.handler = get_handler(thread_index);
+                    item.id = item.handler->add(std::move(callback), delay_ns, FIXED_RATE, spin_ns, slack_ns);
+                }
+                std::lock_guard<std::mutex> lock(method_mutex);
+                return items.insert(std::move(item));
+            }
+
+            inline std::vector<uint64_t> add_events(
+                    std::vector<TimerEventHandler::TimerSpec> &specs,
+                    const size_t thread_index) noexcept {
+                Item item;
+                item.thread_index = thread_index;
+                std::vector<uint64_t> indexes;
+                {
+                    std::lock_guard<std::mutex> lock(handlers_mutex);
+                    item.handler = get_handler(thread_index);
+                    indexes = item.handler->add_many(specs);
+                }
+                std::lock_guard<std::mutex> lock(method_mutex);
+                items.reserve(indexes.size());
+                for (size_t i = 0; i < indexes.size(); ++i) {
+                    item.id = indexes[i];
+                    indexes[i] = items.insert(item);
+                }
+                return indexes;
+            }
+
+            /** \brief Get the handler of the thread, the handler is created on first use
+             * Must be called under handlers_mutex
+             */
+            static inline std::shared_ptr<TimerEventHandler> get_handler(const size_t thread_index) {
+                std::shared_ptr<TimerEventHandler> &item = handlers[thread_index];
+                if (item) return item;
+                auto backend = backends.find(thread_index);
+                auto executor = executors.find(thread_index);
+                auto clock = clocks.find(thread_index);
+                if (clock != clocks.end()) {
+                    item = std::make_shared<TimerEventHandler>(
+                        clock->second,
+                        backend != backends.end() ? backend->second : TIMER_HEAP);
+                } else if (executor != executors.end()) {
+                    item = std::make_shared<TimerEventHandler>(
+                        backend != backends.end() ? backend->second : TIMER_HEAP,
+                        executor->second);
+                } else {
+                    item = std::make_shared<TimerEventHandler>(
+                        backend != backends.end() ? backend->second : TIMER_HEAP,
+                        thread_index == AUTO ? make_auto_executor() : nullptr);
+                }
+                // the new service has no callbacks yet, they can not wait for the lock
+                auto config = configs.find(thread_index);
+                if (config != configs.end()) item->set_thread_config(config->second);
+                return item;
+            }
+
+            /** \brief Remove the events from the handlers, one call per handler
+             */
+            static inline void remove_items(std::vector<Item> &removed) {
+                std::map<TimerEventHandler*, std::vector<uint64_t>> ids;
+                for (size_t i = 0; i < removed.size(); ++i) {
+                    ids[removed[i].handler.get()].push_back(removed[i].id);
+                }
+                for (auto &it : ids) {
+                    it.first->remove_many(it.second);
+                }
+            }
+
+            static inline std::shared_ptr<Executor> make_auto_executor() {
+                return std::make_shared<WorkStealingExecutor>(
+                    std::max(2u, std::thread::hardware_concurrency()));
+            }
+
+        public:
+
+            /** \brief Выбрать очередь таймеров для потока событий
+             * TIMER_HEAP - двоичная куча, точные сроки событий.
+             * TIMER_WHEEL - иерархическое колесо таймеров с шагом 1 мс,
+             * добавление, сброс и удаление событий за O(1).
+             * Подходит для сотен тысяч таймаутов.
+             * \param backend       Очередь таймеров
+             * \param thread_index  Индекс потока событий
+             */
+            static inline void set_backend(
+                    const TimerBackend backend,
+                    const size_t thread_index = 0) noexcept {
+                std::lock_guard<std::mutex> lock(handlers_mutex);
+                backends[thread_index] = backend;
+                auto it = handlers.find(thread_index);
+                if (it == handlers.end()) return;
+                it->second->set_backend(backend);
+            }
+
+            /** \brief Выбрать исполнителя callback-функций для потока событий
+             * По умолчанию callback-функции вызываются в потоке событий.
+             * Пул потоков (ThreadPoolExecutor, WorkStealingExecutor) позволяет
+             * медленным callback-функциям не задерживать другие события.
+             * Одно событие никогда не выполняется параллельно самому себе.
+             * \param executor      Исполнитель, nullptr - поток событий
+             * \param thread_index  Индекс потока событий
+             */
+            static inline void set_executor(
+                    std::shared_ptr<Executor> executor,
                     const size_t thread_index = 0) noexcept {
-                std::lock_guard<std::mutex> lock_1(handlers_mutex);
+                std::lock_guard<std::mutex> lock(handlers_mutex);
+                executors[thread_index] = executor;
                 auto it = handlers.find(thread_index);
-                if (it == handlers.end()) {
-                    handlers[thread_index].run();
+                if (it == handlers.end()) return;
+                it->second->set_executor(executor);
+            }
+
+            /** \brief Использовать виртуальные часы для потока событий
+             * События потока вызываются в VirtualClock::advance_to() по порядку сроков,
+             * без ожидания реального времени. Нужно вызвать до добавления первого события потока.
+             * \param clock         Виртуальные часы, nullptr - монотонные часы
+             * \param thread_index  Индекс потока событий
+             */
+            static inline void set_clock(
+                    std::shared_ptr<VirtualClock> clock,
+                    const size_t thread_index = 0) noexcept {
+                std::lock_guard<std::mutex> lock(handlers_mutex);
+                if (clock) clocks[thread_index] = std::move(clock);
+                else clocks.erase(thread_index);
+            }
+
+            /** \brief Настроить поток событий для событий, чувствительных к задержкам
+             * Настройка применяется к потоку событий и к потокам его исполнителя
+             * (пулу AUTO или пулу из set_executor), сразу или при создании потока.
+             * Например, поток с SCHED_FIFO на изолированном ядре (isolcpus)
+             * не вытесняется потоками служебных событий.
+             * \param config        Имя, ядра процессора, политика планирования и блокировка памяти
+             * \param thread_index  Индекс потока событий
+             * \return Вернет false, если часть настроек не применена (например, нет прав на SCHED_FIFO)
+             */
+            static inline bool set_thread_config(
+                    const ThreadConfig &config,
+                    const size_t thread_index = 0) noexcept {
+                std::shared_ptr<TimerEventHandler> handler;
+                {
+                    std::lock_guard<std::mutex> lock(handlers_mutex);
+                    configs[thread_index] = config;
+                    auto it = handlers.find(thread_index);
+                    if (it == handlers.end()) return true;
+                    handler = it->second;
                 }
-                std::lock_guard<std::mutex> lock_2(method_mutex);
-                indexes.push_back(handlers[thread_index].add(callback, delay_ms));
-                thread_indexes.push_back(thread_index);
-                return indexes.size() - 1;
+                // callbacks of the thread may wait for the lock of the handlers
+                return handler->set_thread_config(config);
+            }
+
+            /** \brief Получить счетчики потока событий
+             * get_saved_wakeups() вернет число пробуждений, сэкономленных
+             * объединением событий.
+             * \param thread_index  Индекс потока событий
+             */
+            static inline TimerStats get_stats(const size_t thread_index = 0) noexcept {
+                std::lock_guard<std::mutex> lock(handlers_mutex);
+                auto it = handlers.find(thread_index);
+                if (it == handlers.end()) return TimerStats();
+                return it->second->get_stats();
             }
 
             /** \brief Сбросить таймер для события
-             * \param index Индекс события для данного экземпляра класса
+             * \param index Дескриптор события, устаревший дескриптор игнорируется
              */
-            inline void reset(const size_t index) noexcept {
-                std::lock_guard<std::mutex> lock_1(method_mutex);
-                if (index >= indexes.size()) return;
-                std::lock_guard<std::mutex> lock_2(handlers_mutex);
-                handlers[thread_indexes[index]].reset(indexes[index]);
+            inline void reset(const uint64_t index) noexcept {
+                std::lock_guard<std::mutex> lock(method_mutex);
+                const Item *item = items.get(index);
+                if (!item) return;
+                item->handler->reset(item->id);
             }
 
             /** \brief Удалить событие
-             * \param index Индекс события для данного экземпляра класса
+             * \param index Дескриптор события, устаревший дескриптор игнорируется
+             */
+            inline void remove(const uint64_t index) noexcept {
+                Item item;
+                {
+                    std::lock_guard<std::mutex> lock(method_mutex);
+                    const Item *found = items.get(index);
+                    if (!found) return;
+                    item = *found;
+                    items.erase(index);
+                }
+                item.handler->remove(item.id);
+            }
+
+            /** \brief Удалить несколько событий
+             * Поток событий получает одну команду для всех событий
+             * \param indexes Дескрипторы событий, устаревшие дескрипторы игнорируются
              */
-            inline void remove(const size_t index) noexcept {
-                std::lock_guard<std::mutex> lock_1(method_mutex);
-                if (index >= indexes.size()) return;
-                std::lock_guard<std::mutex> lock_2(handlers_mutex);
-                handlers[thread_indexes[index]].remove(indexes[index]);
+            inline void remove_many(const std::vector<uint64_t> &indexes) noexcept {
+                std::vector<Item> removed;
+                {
+                    std::lock_guard<std::mutex> lock(method_mutex);
+                    removed.reserve(indexes.size());
+                    for (size_t i = 0; i < indexes.size(); ++i) {
+                        Item *found = items.get(indexes[i]);
+                        if (!found) continue;
+                        removed.push_back(std::move(*found));
+                        items.erase(indexes[i]);
+                    }
+                }
+                remove_items(removed);
             }
 
             /** \brief Удалить все события
              */
             inline void remove_all() noexcept {
-                std::lock_guard<std::mutex> lock_1(method_mutex);
-                for (size_t i = 0; i < indexes.size(); ++i) {
-                    std::lock_guard<std::mutex> lock_2(handlers_mutex);
-                    auto it = handlers.find(thread_indexes[i]);
-                    if (it == handlers.end()) continue;
-                    it->second.remove(indexes[i]);
+                std::vector<Item> removed;
+                {
+                    std::lock_guard<std::mutex> lock(method_mutex);
+                    removed.reserve(items.size());
+                    items.for_each([&removed](const uint64_t, Item &item) {
+                        removed.push_back(std::move(item));
+                    });
+                    items.clear();
                 }
-                for (size_t i = 0; i < indexes.size(); ++i) {
-                    std::lock_guard<std::mutex> lock_2(handlers_mutex);
-                    auto it = handlers.find(thread_indexes[i]);
+                remove_items(removed);
+                std::lock_guard<std::mutex> lock(handlers_mutex);
+                for (size_t i = 0; i < removed.size(); ++i) {
+                    auto it = handlers.find(removed[i].thread_index);
                     if (it == handlers.end()) continue;
-                    if (!it->second.get_num_events()) {
-                        handlers.erase(thread_indexes[i]);
+                    if (!it->second->size()) {
+                        handlers.erase(it);
                     }
                 }
-                indexes.clear();
-                thread_indexes.clear();
             }
         }; // TimerEvent
 
@@ -0,0 +1,370 @@
+/*
+* ztime_cpp - Library for work with time.
+*
+* Copyright (c) 2018 Elektro Yar. Email: git.electroyar@gmail.com
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#pragma once
+#ifndef ZTIME_WEEK_FILTER_HPP_INCLUDED
+#define ZTIME_WEEK_FILTER_HPP_INCLUDED
+
+#include "ztime.hpp"
+#include <vector>
+#include <cstring>
+#include <cctype>
+
+namespace ztime {
+
+    /** \brief Filter of recurring intraday windows
+     *
+     * The filter compiles a set of weekly windows, for example
+     * "MON-FRI 09:30-16:00, SUN 22:00-24:00", into a bitmask of the week
+     * with the resolution of CELL_SEC seconds. A check of a timestamp is a
+     * single bit test without branches, and sorted spans are processed
+     * by whole runs of allowed or forbidden cells.
+     * \tparam CELL_SEC Resolution of the mask in seconds (60 - minute of the week, 1 - second of the week)
+     */
+    template<uint32_t CELL_SEC>
+    class BasicWeekFilter {
+    public:
+
+        static const uint32_t CELLS = SEC_PER_WEEK / CELL_SEC;    /**< Number of cells in a week */
+
+        BasicWeekFilter() : m_mask((CELLS + 63) / 64, 0) {
+            update_shift();
+        };
+
+        /** \brief Set a fixed offset of the windows from GMT
+         * \param offset Offset in seconds (local time = GMT + offset)
+         */
+        inline void set_utc_offset(const int64_t offset) noexcept {
+            m_offset = offset;
+            update_shift();
+        }
+
+        /** \brief Set the unit of the timestamps passed to the filter
+         * \param units_per_second  1 for seconds, MS_PER_SEC for milliseconds, US_PER_SEC for microseconds
+         */
+        inline void set_time_unit(const uint64_t units_per_second) noexcept {
+            if (!units_per_second) return;
+            m_units = units_per_second;
+            update_shift();
+        }
+
+        /** \brief Add a window
+         * \param weekday       Day of the week (SUN = 0, MON = 1, ... SAT = 6)
+         * \param start_second  Second of the day of the window beginning
+         * \param stop_second   Second of the day of the window end, exclusive. Values above SEC_PER_DAY continue the window into the next day
+         * \return Returns true if the window is correct
+         */
+        inline bool add(
+                const uint32_t weekday,
+                const uint32_t start_second,
+                const uint32_t stop_second) noexcept {
+            if (weekday >= DAYS_PER_WEEK) return false;
+            if (start_second >= stop_second) return false;
+            if (start_second >= SEC_PER_DAY) return false;
+            if (stop_second > SEC_PER_WEEK) return false;
+            const uint32_t beg = (weekday * SEC_PER_DAY + start_second) / CELL_SEC;
+            const uint32_t end = (weekday * SEC_PER_DAY + stop_second + CELL_SEC - 1) / CELL_SEC;
+            for (uint32_t i = beg; i < end; ++i) {
+                const uint32_t cell = i % CELLS;
+                m_mask[cell >> 6] |= (uint64_t)1 << (cell & 63);
+            }
+            return true;
+        }
+
+        /** \brief Add a window for a range of weekdays
+         * \param weekday_from  First day of the week (SUN = 0, MON = 1, ... SAT = 6)
+         * \param weekday_to    Last day of the week, inclusive
+         * \param start_second  Second of the day of the window beginning
+         * \param stop_second   Second of the day of the window end, exclusive
+         * \return Returns true if the windows are correct
+         */
+        inline bool add(
+                const uint32_t weekday_from,
+                const uint32_t weekday_to,
+                const uint32_t start_second,
+                const uint32_t stop_second) noexcept {
+            if (weekday_from > weekday_to) return false;
+            for (uint32_t wday = weekday_from; wday <= weekday_to; ++wday) {
+                if (!add(wday, start_second, stop_second)) return false;
+            }
+            return true;
+        }
+
+        /** \brief Add windows from a string
+         *
+         * Format: list of "DAYS HH:MM-HH:MM" separated by commas or semicolons,
+         * where DAYS is a day name (SUN, MON, ... SAT) or a range of days, for example
+         * "MON-FRI 09:30-16:00, SUN 22:00-24:00". Seconds (HH:MM:SS) are allowed.
+         * \param str Windows in the string format
+         * \return Returns true if all windows are parsed
+         */
+        bool add(std::string str) {
+            // the en dash is replaced with a hyphen
+            const std::string en_dash("\xE2\x80\x93");
+            size_t pos = 0;
+            while ((pos = str.find(en_dash, pos)) != std::string::npos) {
+                str.replace(pos, en_dash.size(), "-");
+            }
+            str += ",";
+            size_t start_pos = 0;
+            while (true) {
+                const size_t found = str.find_first_of(",;", start_pos);
+                if (found == std::string::npos) break;
+                const std::string item = str.substr(start_pos, found - start_pos);
+                start_pos = found + 1;
+                if (item.find_first_not_of(" \t") == std::string::npos) continue;
+                if (!add_item(item)) return false;
+            }
+            return true;
+        }
+
+        /** \brief Remove all windows
+         */
+        inline void clear() noexcept {
+            std::fill(m_mask.begin(), m_mask.end(), 0);
+        }
+
+        /** \brief Check a timestamp
+         * \param t Timestamp in the units set by set_time_unit()
+         * \return Returns true if the timestamp is inside a window
+         */
+        inline bool check(const uint64_t t) const noexcept {
+            const uint32_t cell = get_cell(t);
+            return (m_mask[cell >> 6] >> (cell & 63)) & 1;
+        }
+
+        /** \brief Classify an array of timestamps
+         * \param src   Array of timestamps
+         * \param n     Number of timestamps
+         * \param dst   Output array, 1 - timestamp is inside a window, 0 - outside
+         */
+        inline void classify(const uint64_t *src, const size_t n, uint8_t *dst) const noexcept {
+            for (size_t i = 0; i < n; ++i) {
+                const uint32_t cell = get_cell(src[i]);
+                dst[i] = (uint8_t)((m_mask[cell >> 6] >> (cell & 63)) & 1);
+            }
+        }
+
+        /** \brief Count timestamps inside the windows
+         * \param src   Array of timestamps
+         * \param n     Number of timestamps
+         * \return Number of timestamps inside the windows
+         */
+        inline size_t count(const uint64_t *src, const size_t n) const noexcept {
+            size_t k = 0;
+            for (size_t i = 0; i < n; ++i) {
+                const uint32_t cell = get_cell(src[i]);
+                k += (m_mask[cell >> 6] >> (cell & 63)) & 1;
+            }
+            return k;
+        }
+
+        /** \brief Copy timestamps inside the windows
+         * The input array may be unsorted. dst may be equal to src
+         * \param src   Array of timestamps
+         * \param n     Number of timestamps
+         * \param dst   Output array with at least n elements
+         * \return Number of copied timestamps
+         */
+        inline size_t filter(const uint64_t *src, const size_t n, uint64_t *dst) const noexcept {
+            size_t k = 0;
+            for (size_t i = 0; i < n; ++i) {
+                const uint64_t t = src[i];
+                const uint32_t cell = get_cell(t);
+                dst[k] = t;
+                k += (m_mask[cell >> 6] >> (cell & 63)) & 1;
+            }
+            return k;
+        }
+
+        /** \brief Find the end of the run of cells with the same state
+         * \param t Timestamp in the units set by set_time_unit()
+         * \return First timestamp after t at which the state of the filter changes, or MAX_TIMESTAMP if it never changes
+         */
+        inline uint64_t next_change(const uint64_t t) const noexcept {
+            const uint32_t cell = get_cell(t);
+            const uint32_t len = run_length(cell);
+            if (len >= CELLS) return MAX_TIMESTAMP;
+            const uint64_t units_per_cell = (uint64_t)CELL_SEC * m_units;
+            const uint64_t cell_start = t - ((t + m_shift) % units_per_cell);
+            return cell_start + (uint64_t)len * units_per_cell;
+        }
+
+        /** \brief Find runs of timestamps inside the windows in a sorted array
+         *
+         * Whole runs of ticks inside one allowed or forbidden interval are
+         * skipped with a binary search, so the cost depends on the number of
+         * window boundaries in the data and not on the number of ticks.
+         * \param src   Sorted array of timestamps
+         * \param n     Number of timestamps
+         * \param runs  Output array of index ranges [start, stop) inside the windows
+         */
+        template<class PERIOD_CONTAINER_TYPE>
+        void find_runs(const uint64_t *src, const size_t n, PERIOD_CONTAINER_TYPE &runs) const {
+            typedef typename PERIOD_CONTAINER_TYPE::value_type period_type;
+            size_t i = 0;
+            while (i < n) {
+                const bool state = check(src[i]);
+                const uint64_t change = next_change(src[i]);
+                const size_t j = (size_t)(std::lower_bound(src + i, src + n, change) - src);
+                if (state) runs.insert(runs.end(), period_type(i, j));
+                i = j;
+            }
+        }
+
+        /** \brief Copy timestamps inside the windows from a sorted array
+         * \param src   Sorted array of timestamps
+         * \param n     Number of timestamps
+         * \param dst   Output array with at least n elements. dst may be equal to src
+         * \return Number of copied timestamps
+         */
+        size_t filter_sorted(const uint64_t *src, const size_t n, uint64_t *dst) const noexcept {
+            size_t i = 0, k = 0;
+            while (i < n) {
+                const bool state = check(src[i]);
+                const uint64_t change = next_change(src[i]);
+                const size_t j = (size_t)(std::lower_bound(src + i, src + n, change) - src);
+                if (state) {
+                    if (dst + k != src + i) std::memmove(dst + k, src + i, (j - i) * sizeof(uint64_t));
+                    k += j - i;
+                }
+                i = j;
+            }
+            return k;
+        }
+
+        /** \brief Get the compiled mask
+         * \return Bitmask of the week starting from Sunday 00:00
+         */
+        inline const std::vector<uint64_t> &get_mask() const noexcept {
+            return m_mask;
+        }
+
+    private:
+        std::vector<uint64_t>   m_mask;
+        int64_t                 m_offset = 0;
+        uint64_t                m_units = 1;
+        uint64_t                m_shift = 0;    /**< Shift of the timestamp to the beginning of the week, in units */
+
+        inline void update_shift() noexcept {
+            // the UNIX epoch starts on Thursday
+            int64_t shift = ((int64_t)THU * SEC_PER_DAY + m_offset) % (int64_t)SEC_PER_WEEK;
+            if (shift < 0) shift += SEC_PER_WEEK;
+            m_shift = (uint64_t)shift * m_units;
+        }
+
+        inline uint32_t get_cell(const uint64_t t) const noexcept {
+            return (uint32_t)(((t + m_shift) / ((uint64_t)CELL_SEC * m_units)) % CELLS);
+        }
+
+        inline bool get_bit(const uint32_t cell) const noexcept {
+            return (m_mask[cell >> 6] >> (cell & 63)) & 1;
+        }
+
+        /** \brief Get the number of cells with the same state starting from the cell
+         */
+        inline uint32_t run_length(const uint32_t cell) const noexcept {
+            const uint64_t invert = get_bit(cell) ? ~(uint64_t)0 : 0;
+            const size_t words = m_mask.size();
+            uint32_t pos = cell;
+            uint32_t len = 0;
+            while (len < CELLS) {
+                const uint32_t bit = pos & 63;
+                uint64_t word = (m_mask[pos >> 6] ^ invert) >> bit;
+                uint32_t avail = 64 - bit;
+                if ((pos >> 6) == (words - 1) && (CELLS & 63)) {
+                    avail = (CELLS & 63) - bit;
+                }
+                if (avail < 64) word &= ((uint64_t)1 << avail) - 1;
+                if (word) {
+                    len += (uint32_t)__builtin_ctzll(word);
+                    return len < CELLS ? len : CELLS;
+                }
+                len += avail;
+                pos = (pos + avail) % CELLS;
+            }
+            return CELLS;
+        }
+
+        bool add_item(const std::string &item) {
+            const size_t beg = item.find_first_not_of(" \t");
+            const size_t space = item.find_first_of(" \t", beg);
+            if (space == std::string::npos) return false;
+            const std::string days = item.substr(beg, space - beg);
+            const size_t time_beg = item.find_first_not_of(" \t", space);
+            if (time_beg == std::string::npos) return false;
+            const size_t time_end = item.find_last_not_of(" \t");
+            const std::string times = item.substr(time_beg, time_end - time_beg + 1);
+
+            const size_t days_sep = days.find('-');
+            const int day_from = parse_weekday(days.substr(0, days_sep));
+            const int day_to = days_sep == std::string::npos ? day_from : parse_weekday(days.substr(days_sep + 1));
+            if (day_from < 0 || day_to < 0) return false;
+
+            const size_t times_sep = times.find('-');
+            if (times_sep == std::string::npos) return false;
+            const int start = parse_second_day(times.substr(0, times_sep));
+            const int stop = parse_second_day(times.substr(times_sep + 1));
+            if (start < 0 || stop < 0) return false;
+
+            // the range of days may wrap around the end of the week, for example SAT-SUN
+            int day = day_from;
+            while (true) {
+                const uint32_t stop_second = stop > start ? stop : stop + SEC_PER_DAY;
+                if (!add((uint32_t)day, (uint32_t)start, stop_second)) return false;
+                if (day == day_to) break;
+                day = (day + 1) % DAYS_PER_WEEK;
+            }
+            return true;
+        }
+
+        static int parse_weekday(std::string str) {
+            if (str.size() < 3) return -1;
+            str = str.substr(0, 3);
+            std::transform(str.begin(), str.end(), str.begin(), ::toupper);
+            for (int i = 0; i < DAYS_PER_WEEK; ++i) {
+                if (str == WeekdayNameShort[i]) return i;
+            }
+            return -1;
+        }
+
+        static int parse_second_day(const std::string &str) {
+            const size_t beg = str.find_first_not_of(" \t");
+            if (beg == std::string::npos) return -1;
+            const size_t end = str.find_last_not_of(" \t");
+            const std::string value = str.substr(beg, end - beg + 1);
+            if (value == "24:00" || value == "24:00:00") return SEC_PER_DAY;
+            if (value.find_first_not_of("0123456789:") != std::string::npos) return -1;
+            try {
+                return to_second_day(value);
+            } catch(...) {}
+            return -1;
+        }
+    };
+
+    typedef BasicWeekFilter<SEC_PER_MIN> WeekFilter;    ///< Filter with the minute of the week resolution (10080 bits)
+    typedef BasicWeekFilter<1> WeekSecondFilter;        ///< Filter with the second of the week resolution (604800 bits)
+
+}; // ztime
+
+#endif // ZTIME_WEEK_FILTER_HPP_INCLUDED